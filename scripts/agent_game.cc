@@ -85,7 +85,7 @@ auto main(int argc, char **argv) -> int
             last_actions.emplace_back(action);
             field.perform_action(i, action);
         }
-        field.time_remaining--;
+        field.tick();
     }
     print_state();
 }
@@ -58,7 +58,7 @@ auto main(int argc, char **argv) -> int
             auto action = agents[i]->next_action(field);
             field.perform_action(i, action);
         }
-        field.time_remaining--;
+        field.tick();
     }
     print_state();
 }
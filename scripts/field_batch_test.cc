@@ -0,0 +1,108 @@
+#include <great_risks/field_batch.hh>
+#include <great_risks/simulator.hh>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace great_risks;
+
+// Plays `size` random games in a batch and in one field per game, and compares them after every
+// step. Returns the number of mismatches.
+template <typename G>
+int check_batch(const char *name, const BasicField<G> &start, std::size_t size, unsigned seed)
+{
+    BasicFieldBatch<G> batch(size, start);
+    std::vector<BasicField<G>> fields(size, start);
+    std::vector<ActionMask> masks(size);
+    std::vector<Action> actions(size);
+    std::vector<int> red(size);
+    std::vector<int> blue(size);
+    std::mt19937 rng(seed);
+    int mismatches = 0;
+    auto report = [&](std::size_t game, const char *what)
+    {
+        std::cerr << name << " size " << size << " game " << game << " time "
+                  << int(fields[game].time_remaining) << ": " << what << " differs" << std::endl;
+        mismatches++;
+    };
+
+    while (fields[0].time_remaining > 0 && mismatches == 0)
+    {
+        for (std::uint8_t i = 0; i < start.robots.size(); i++)
+        {
+            batch.legal_action_masks(i, masks.data());
+            for (std::size_t game = 0; game < size; game++)
+            {
+                ActionMask mask = fields[game].legal_action_mask(i);
+                if (masks[game] != mask)
+                {
+                    report(game, "legal action mask");
+                }
+                actions[game] = pick_nth(mask, rng() % count_actions(mask));
+                fields[game].perform_action(i, actions[game]);
+            }
+            batch.step(i, actions.data());
+            for (std::size_t game = 0; game < size; game++)
+            {
+                if (!(batch.get(game) == fields[game]))
+                {
+                    report(game, "state after step");
+                }
+            }
+        }
+        batch.tick();
+        batch.scores(red.data(), blue.data());
+        for (std::size_t game = 0; game < size; game++)
+        {
+            fields[game].tick();
+            if (!(batch.get(game) == fields[game]))
+            {
+                report(game, "state after tick");
+            }
+            auto [red_score, blue_score] = fields[game].calculate_scores();
+            if (red[game] != red_score || blue[game] != blue_score)
+            {
+                report(game, "score");
+            }
+        }
+    }
+    return mismatches;
+}
+
+auto main(int argc, char **argv) -> int
+{
+    unsigned games = argc > 1 ? std::stoi(argv[1]) : 4;
+
+    Field field;
+    Robot robot_1;
+    robot_1.x = 1;
+    robot_1.y = 0;
+    robot_1.is_red = true;
+    field.add_robot(robot_1);
+    Robot robot_2;
+    robot_2.x = 9;
+    robot_2.y = 10;
+    robot_2.is_red = false;
+    field.add_robot(robot_2);
+    ReducedField reduced_field;
+
+    // sizes below, at and past one AVX2 lane, and ones that leave a scalar tail
+    const std::size_t sizes[] = {1, 7, 8, 13, 37};
+    int mismatches = 0;
+    for (unsigned seed = 0; seed < games; seed++)
+    {
+        for (std::size_t size : sizes)
+        {
+            mismatches += check_batch("Field", field, size, seed);
+            mismatches += check_batch("ReducedField", reduced_field, size, seed);
+        }
+    }
+    if (mismatches > 0)
+    {
+        std::cout << mismatches << " mismatches" << std::endl;
+        return 1;
+    }
+    std::cout << "batches match the per-game fields" << std::endl;
+    return 0;
+}
@@ -55,7 +55,7 @@ auto main(int argc, char **argv) -> int
         if (std::find(legal_actions.begin(), legal_actions.end(), j["action"]) != legal_actions.end())
         {
             field.perform_action(0, j["action"]);
-            field.time_remaining--;
+            field.tick();
         }
     }
 }
@@ -1,18 +1,35 @@
 #include <great_risks/greedy_agent.hh>
 #include <great_risks/mcts_agent_greedy.hh>
 #include <great_risks/mcts_agent_random.hh>
+#include <great_risks/thread_pool.hh>
 #include <ctime>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <thread>
 #include <mutex>
+#include <string>
+#include <vector>
 
 int red_wins = 0;
 int blue_wins = 0;
 int ties = 0;
 std::mutex mtx;
 using namespace great_risks;
+SearchLimits limits;
+unsigned leaf_rollouts = 1;
+unsigned red_processes = 1;
+unsigned rollout_horizon = 0;
+std::size_t rollout_cache_memory = RolloutCache::DEFAULT_MEMORY;
+// search iterations of each agent over all moves, to compare settings at equal time
+std::atomic<std::size_t> red_iterations = 0;
+std::atomic<std::size_t> blue_iterations = 0;
+std::atomic<int> moves = 0;
+// playout cache counts of both agents over all matches
+RolloutCache::Stats rollout_cache;
 
 void run_match() {
     Field field;
@@ -28,19 +45,39 @@ void run_match() {
     field.add_robot(robot_2);
     std::vector<std::unique_ptr<Agent>> agents;
     mtx.lock();
-    agents.emplace_back(std::make_unique<MCTSAgentGreedy>(0, 1, rand()));
-    agents.emplace_back(std::make_unique<MCTSAgentRandom>(1, rand()));
+    auto red = std::make_unique<MCTSAgentGreedy>(0, 1, rand());
+    auto blue = std::make_unique<MCTSAgentRandom>(1, rand());
     mtx.unlock();
+    red->set_limits(limits);
+    blue->set_limits(limits);
+    blue->set_leaf_rollouts(leaf_rollouts);
+    red->set_processes(red_processes);
+    red->set_rollout_horizon(rollout_horizon);
+    blue->set_rollout_horizon(rollout_horizon);
+    red->set_rollout_cache_memory(rollout_cache_memory);
+    blue->set_rollout_cache_memory(rollout_cache_memory);
+    MCTSAgentGreedy &red_agent = *red;
+    MCTSAgentRandom &blue_agent = *blue;
+    agents.push_back(std::move(red));
+    agents.push_back(std::move(blue));
     while (field.time_remaining > 0) {
         for (size_t i = 0; i < agents.size(); i++)
         {
             auto action = agents[i]->next_action(field);
             field.perform_action(i, action);
         }
-        field.time_remaining--;
+        red_iterations += red_agent.last_iterations();
+        blue_iterations += blue_agent.last_iterations();
+        moves++;
+        field.tick();
     }
     auto [red_score, blue_score] = field.calculate_scores();
     mtx.lock();
+    for (RolloutCache::Stats stats : {red_agent.rollout_cache_stats(), blue_agent.rollout_cache_stats()}) {
+        rollout_cache.hits += stats.hits;
+        rollout_cache.misses += stats.misses;
+        rollout_cache.evictions += stats.evictions;
+    }
     std::cout << "" << red_score << " " << blue_score << "\n";
     if (red_score > blue_score) {
         red_wins++;
@@ -52,17 +89,48 @@ void run_match() {
     mtx.unlock();
 }
 
-int main() {
+// usage: tournament [num_threads] [pin|nopin] [ms_per_move] [leaf_rollouts] [red_processes] [rollout_horizon] [rollout_cache_mib]
+int main(int argc, char **argv) {
     srand(time(NULL));
-    for (int i = 0; i < 100; i+= 5) {
-        std::cout << "running match " << i << "\n";
-        std::vector<std::thread> threads;
-        for (int j = 0; j < 5; j++) {
-            threads.emplace_back(run_match);
-        }
-        for (auto &thread : threads) {
-            thread.join();
-        }
+    if (argc > 1) {
+        ThreadPool::configure(std::atoi(argv[1]), argc > 2 && std::string(argv[2]) == "pin");
+    }
+    if (argc > 3) {
+        // a deadline instead of a fixed iteration count per move
+        limits.iterations = SIZE_MAX;
+        limits.time = std::chrono::milliseconds(std::atoi(argv[3]));
+    }
+    if (argc > 4) {
+        // playouts per leaf of the random agent's search
+        leaf_rollouts = std::atoi(argv[4]);
+    }
+    if (argc > 5) {
+        // forked root-parallel searches of the greedy agent
+        red_processes = std::atoi(argv[5]);
+    }
+    if (argc > 6) {
+        // playouts of both agents are estimated after this many plies
+        rollout_horizon = std::atoi(argv[6]);
+    }
+    if (argc > 7) {
+        // playout cache budget of each agent
+        rollout_cache_memory = std::size_t(std::atoi(argv[7])) << 20;
+    }
+    // matches and the agents' searches share one pool
+    ThreadPool &pool = ThreadPool::global();
+    std::cout << "running 100 matches on " << pool.size() << " threads\n";
+    ThreadPool::TaskGroup matches;
+    for (int i = 0; i < 100; i++) {
+        pool.submit(matches, run_match);
     }
+    pool.wait(matches);
     std::cout << "red wins: " << red_wins << " blue wins: " << blue_wins << " ties: " << ties << "\n";
+    std::cout << "iterations per move: red " << red_iterations / moves << " blue " << blue_iterations / moves << "\n";
+    std::cout << "rollout cache hits: " << rollout_cache.hits << " misses: " << rollout_cache.misses
+              << " evictions: " << rollout_cache.evictions << "\n";
+    auto greedy_cache = MCTSAgentGreedy::greedy_cache_stats();
+    std::cout << "greedy cache hits: " << greedy_cache.hits << " misses: " << greedy_cache.misses
+              << " evictions: " << greedy_cache.evictions << "\n";
+    auto distance_maps = GreedyAgent::distance_map_stats();
+    std::cout << "distance map hits: " << distance_maps.hits << " misses: " << distance_maps.misses << "\n";
 }
\ No newline at end of file
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+namespace great_risks
+{
+    enum Action
+    {
+        MOVE_NORTH,
+        MOVE_SOUTH,
+        MOVE_EAST,
+        MOVE_WEST,
+        GRAB_MOBILE_GOAL,
+        RELEASE_MOBILE_GOAL,
+        TIP_MOBILE_GOAL,
+        UNTIP_MOBILE_GOAL,
+        PICK_UP_RED,
+        PICK_UP_BLUE,
+        RELEASE_RING,
+        SCORE_MOBILE_GOAL,
+        SCORE_WALL_STAKE,
+        DESCORE_MOBILE_GOAL,
+        DESCORE_WALL_STAKE,
+        DO_NOTHING
+    };
+
+    constexpr std::size_t NUM_ACTIONS = DO_NOTHING + 1;
+
+    // set of actions with bit a set for every action a in the set
+    using ActionMask = std::uint16_t;
+
+    constexpr ActionMask action_bit(Action a)
+    {
+        return static_cast<ActionMask>(1u << a);
+    }
+
+    constexpr ActionMask MOVE_ACTIONS =
+        action_bit(MOVE_NORTH) | action_bit(MOVE_SOUTH) | action_bit(MOVE_EAST) | action_bit(MOVE_WEST);
+
+    // order legal_actions() has always listed actions in, kept so agents that index into that
+    // list behave as before
+    constexpr std::array<Action, NUM_ACTIONS> ACTION_ORDER = {
+        MOVE_NORTH,
+        MOVE_SOUTH,
+        MOVE_EAST,
+        MOVE_WEST,
+        UNTIP_MOBILE_GOAL,
+        GRAB_MOBILE_GOAL,
+        TIP_MOBILE_GOAL,
+        RELEASE_MOBILE_GOAL,
+        SCORE_MOBILE_GOAL,
+        DESCORE_MOBILE_GOAL,
+        PICK_UP_RED,
+        PICK_UP_BLUE,
+        RELEASE_RING,
+        SCORE_WALL_STAKE,
+        DESCORE_WALL_STAKE,
+        DO_NOTHING};
+
+    inline bool has_action(ActionMask mask, Action a)
+    {
+        return mask & action_bit(a);
+    }
+
+    inline unsigned count_actions(ActionMask mask)
+    {
+        return __builtin_popcount(mask);
+    }
+
+    // n-th action of the mask in enum order, n must be below count_actions(mask)
+    inline Action pick_nth(ActionMask mask, unsigned n)
+    {
+#ifdef __BMI2__
+        return static_cast<Action>(__builtin_ctz(_pdep_u32(1u << n, mask)));
+#else
+        for (; n > 0; n--)
+        {
+            mask &= mask - 1;
+        }
+        return static_cast<Action>(__builtin_ctz(mask));
+#endif
+    }
+
+    // Sample where actions in `preferred` carry weight 2 and all others weight 1. r must be below
+    // count_actions(mask) + count_actions(mask & preferred).
+    inline Action pick_weighted(ActionMask mask, ActionMask preferred, unsigned r)
+    {
+        unsigned n = count_actions(mask);
+        return r < n ? pick_nth(mask, r) : pick_nth(mask & preferred, r - n);
+    }
+
+    // first action of the mask in ACTION_ORDER
+    inline Action first_action(ActionMask mask)
+    {
+        for (Action a : ACTION_ORDER)
+        {
+            if (has_action(mask, a))
+            {
+                return a;
+            }
+        }
+        return DO_NOTHING;
+    }
+
+    inline std::vector<Action> action_list(ActionMask mask)
+    {
+        std::vector<Action> result;
+        result.reserve(count_actions(mask));
+        for (Action a : ACTION_ORDER)
+        {
+            if (has_action(mask, a))
+            {
+                result.push_back(a);
+            }
+        }
+        return result;
+    }
+
+    // iterates the actions of a mask in enum order: for (Action a : ActionRange(mask))
+    class ActionRange
+    {
+    private:
+        ActionMask mask;
+
+    public:
+        class iterator
+        {
+        private:
+            ActionMask mask;
+
+        public:
+            explicit iterator(ActionMask mask) : mask(mask) {};
+
+            Action operator*() const
+            {
+                return static_cast<Action>(__builtin_ctz(mask));
+            }
+
+            iterator &operator++()
+            {
+                mask &= mask - 1;
+                return *this;
+            }
+
+            bool operator!=(const iterator &other) const
+            {
+                return mask != other.mask;
+            }
+        };
+
+        explicit ActionRange(ActionMask mask) : mask(mask) {};
+
+        iterator begin() const
+        {
+            return iterator(mask);
+        }
+
+        iterator end() const
+        {
+            return iterator(0);
+        }
+    };
+}  // namespace great_risks
@@ -2,6 +2,8 @@
 
 #include "simulator.hh"
 
+#include <cstddef>
+
 namespace great_risks
 {
     class Agent
@@ -12,6 +14,16 @@ namespace great_risks
     public:
         Agent(std::uint8_t robot_index) : robot_index(robot_index) {};
         virtual ~Agent() = default;
-        virtual Action next_action(Field field) = 0;
+        virtual Action next_action(const Field &field) = 0;
+
+        // actions[i] = next_action(fields[i]) for count fields, agents can override it to decide
+        // for all of them at once
+        virtual void next_actions(const Field *fields, std::size_t count, Action *actions)
+        {
+            for (std::size_t i = 0; i < count; i++)
+            {
+                actions[i] = next_action(fields[i]);
+            }
+        }
     };
 }  // namespace great_risks
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace great_risks
+{
+    // Append-only storage handing out 32-bit indices. Elements live in fixed-size blocks that
+    // never move, so an index stays valid while other threads allocate. clear() only resets the
+    // count and keeps the blocks: elements are handed out again as they were left, so whoever
+    // allocates one has to initialize it.
+    template <typename T>
+    class Arena
+    {
+    public:
+        static constexpr std::uint32_t BLOCK_BITS = 12;
+        static constexpr std::uint32_t BLOCK_SIZE = 1u << BLOCK_BITS;
+        static constexpr std::uint32_t MAX_BLOCKS = 1u << 16;
+        static constexpr std::uint32_t CAPACITY = MAX_BLOCKS * BLOCK_SIZE;
+
+    private:
+        std::unique_ptr<std::atomic<T *>[]> blocks;
+        std::atomic<std::uint32_t> count = 0;
+        std::mutex grow_mutex;
+
+        void ensure_block(std::uint32_t b)
+        {
+            if (blocks[b].load(std::memory_order_acquire) != nullptr)
+            {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(grow_mutex);
+            if (blocks[b].load(std::memory_order_relaxed) == nullptr)
+            {
+                blocks[b].store(new T[BLOCK_SIZE], std::memory_order_release);
+            }
+        }
+
+    public:
+        Arena() : blocks(new std::atomic<T *>[MAX_BLOCKS]()) {};
+
+        ~Arena()
+        {
+            for (std::uint32_t b = 0; b < MAX_BLOCKS; b++)
+            {
+                delete[] blocks[b].load();
+            }
+        }
+
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+        T &operator[](std::uint32_t i)
+        {
+            return blocks[i >> BLOCK_BITS].load(std::memory_order_acquire)[i & (BLOCK_SIZE - 1)];
+        }
+
+        const T &operator[](std::uint32_t i) const
+        {
+            return blocks[i >> BLOCK_BITS].load(std::memory_order_acquire)[i & (BLOCK_SIZE - 1)];
+        }
+
+        // index of n consecutive elements, 0 < n <= BLOCK_SIZE. A range never spans two blocks,
+        // the rest of a block that can't hold it is skipped. Callers keep size() below CAPACITY.
+        std::uint32_t allocate(std::uint32_t n = 1)
+        {
+            while (true)
+            {
+                std::uint32_t first = count.fetch_add(n);
+                std::uint32_t last = first + n - 1;
+                ensure_block(last >> BLOCK_BITS);
+                if ((first >> BLOCK_BITS) == (last >> BLOCK_BITS))
+                {
+                    return first;
+                }
+            }
+        }
+
+        std::uint32_t size() const
+        {
+            return count.load();
+        }
+
+        void clear()
+        {
+            count = 0;
+        }
+    };
+}  // namespace great_risks
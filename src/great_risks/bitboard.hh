@@ -0,0 +1,121 @@
+#pragma once
+
+#include "actions.hh"
+
+#include <array>
+#include <cstdint>
+
+namespace great_risks
+{
+    // Set of board cells with bit x * width + y set for every cell (x, y) in the set. Boards up to
+    // 11x11 fit in 128 bits.
+    using CellMask = unsigned __int128;
+
+    constexpr CellMask cell_bit(unsigned cell)
+    {
+        return static_cast<CellMask>(1) << cell;
+    }
+
+    constexpr bool has_cell(CellMask mask, unsigned cell)
+    {
+        return (mask >> cell) & 1;
+    }
+
+    inline unsigned count_cells(CellMask mask)
+    {
+        return __builtin_popcountll(static_cast<std::uint64_t>(mask)) +
+               __builtin_popcountll(static_cast<std::uint64_t>(mask >> 64));
+    }
+
+    // lowest cell in a non-empty mask
+    inline unsigned first_cell(CellMask mask)
+    {
+        auto low = static_cast<std::uint64_t>(mask);
+        return low ? __builtin_ctzll(low) : 64 + __builtin_ctzll(static_cast<std::uint64_t>(mask >> 64));
+    }
+
+    template <std::uint8_t W>
+    constexpr unsigned cell_index(unsigned x, unsigned y)
+    {
+        return x * W + y;
+    }
+
+    template <std::uint8_t W>
+    constexpr CellMask board_cells()
+    {
+        static_assert(W * W <= 128, "board does not fit in a CellMask");
+        CellMask mask = 0;
+        for (unsigned cell = 0; cell < W * W; cell++)
+        {
+            mask |= cell_bit(cell);
+        }
+        return mask;
+    }
+
+    // moves that stay on a WxW board from every cell
+    template <std::uint8_t W>
+    constexpr std::array<ActionMask, W * W> make_on_board_moves()
+    {
+        std::array<ActionMask, W * W> moves = {};
+        for (unsigned x = 0; x < W; x++)
+        {
+            for (unsigned y = 0; y < W; y++)
+            {
+                ActionMask mask = 0;
+                if (x > 0)
+                {
+                    mask |= action_bit(MOVE_NORTH);
+                }
+                if (x < W - 1)
+                {
+                    mask |= action_bit(MOVE_SOUTH);
+                }
+                if (y < W - 1)
+                {
+                    mask |= action_bit(MOVE_EAST);
+                }
+                if (y > 0)
+                {
+                    mask |= action_bit(MOVE_WEST);
+                }
+                moves[x * W + y] = mask;
+            }
+        }
+        return moves;
+    }
+
+    template <std::uint8_t W>
+    inline constexpr std::array<ActionMask, W * W> ON_BOARD_MOVES = make_on_board_moves<W>();
+
+    // Moves from (x, y) into cells of `free`, all four directions at once: the window of `free`
+    // starting at the northern neighbour holds the west, east and south neighbours at fixed
+    // offsets, and moves that would leave the board are masked out afterwards.
+    template <std::uint8_t W>
+    inline ActionMask neighbour_moves(CellMask free, unsigned x, unsigned y)
+    {
+        unsigned cell = x * W + y;
+        auto window = static_cast<std::uint64_t>(cell >= W ? free >> (cell - W) : free << (W - cell));
+        unsigned moves = (window & 1) << MOVE_NORTH | ((window >> (2 * W)) & 1) << MOVE_SOUTH |
+                         ((window >> (W + 1)) & 1) << MOVE_EAST | ((window >> (W - 1)) & 1) << MOVE_WEST;
+        return moves & ON_BOARD_MOVES<W>[cell];
+    }
+
+    // cell reached by a move that stays on the board
+    template <std::uint8_t W>
+    constexpr unsigned neighbour_cell(unsigned cell, Action move)
+    {
+        return move == MOVE_NORTH ? cell - W : move == MOVE_SOUTH ? cell + W : move == MOVE_EAST ? cell + 1 : cell - 1;
+    }
+
+    // cells occupied by the robots of a field, used to check the incrementally maintained mask
+    template <typename F>
+    CellMask robot_cells(const F &field)
+    {
+        CellMask mask = 0;
+        for (const auto &robot : field.robots)
+        {
+            mask |= cell_bit(robot.x * F::WIDTH + robot.y);
+        }
+        return mask;
+    }
+}  // namespace great_risks
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// Self-checks that recompute incrementally maintained state from scratch. They are far too slow
+// for search, so they are only compiled in when GREAT_RISKS_DEBUG_CHECKS is defined (the default
+// for Debug builds).
+#ifdef GREAT_RISKS_DEBUG_CHECKS
+#define GREAT_RISKS_CHECK(cond) ((cond) ? (void)0 : great_risks::check_failed(#cond, __FILE__, __LINE__))
+#else
+#define GREAT_RISKS_CHECK(cond) ((void)0)
+#endif
+
+namespace great_risks
+{
+    [[noreturn]] inline void check_failed(const char *cond, const char *file, int line)
+    {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, cond);
+        std::abort();
+    }
+}  // namespace great_risks
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "path.hh"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace great_risks
+{
+    // Direct-mapped cache of multi-source BFS distance grids on a WxW board. A grid holds, for every
+    // free cell, the number of moves to the nearest target, so any robot can read its next move
+    // towards a target class off the grid instead of running its own search. Grids are keyed on
+    // the free cells (which encode robot positions and the phase) and the target cells, and a
+    // colliding configuration simply replaces the old entry. Not thread safe, use one per thread;
+    // only stats() may be called from other threads.
+    template <std::uint8_t W>
+    class DistanceMapCache
+    {
+    public:
+        static constexpr std::uint8_t UNREACHABLE = 255;
+        using Distances = std::array<std::uint8_t, W * W>;
+
+        struct Stats
+        {
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+        };
+
+    private:
+        struct Entry
+        {
+            CellMask free = 0;
+            CellMask targets = 0;
+            bool valid = false;
+            Distances distances;
+        };
+
+        std::vector<Entry> entries;
+        // written by the owning thread only, so a relaxed load and store is enough to count
+        std::atomic<std::uint64_t> hit_count = 0;
+        std::atomic<std::uint64_t> miss_count = 0;
+
+        static void bump(std::atomic<std::uint64_t> &count)
+        {
+            count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        static std::uint64_t hash(CellMask free, CellMask targets)
+        {
+            std::uint64_t h = static_cast<std::uint64_t>(free) ^ static_cast<std::uint64_t>(free >> 64) * 0x9e3779b97f4a7c15ull ^
+                              static_cast<std::uint64_t>(targets) * 0xbf58476d1ce4e5b9ull ^
+                              static_cast<std::uint64_t>(targets >> 64) * 0x94d049bb133111ebull;
+            h ^= h >> 31;
+            h *= 0xd6e8feb86659fd93ull;
+            return h ^ (h >> 32);
+        }
+
+        static void compute(CellMask free, CellMask targets, Distances &distances)
+        {
+            distances.fill(UNREACHABLE);
+            std::array<std::uint8_t, W * W> queue;
+            unsigned head = 0;
+            unsigned tail = 0;
+            CellMask sources = targets & free;
+            for (CellMask rest = sources; rest; rest &= rest - 1)
+            {
+                unsigned cell = first_cell(rest);
+                distances[cell] = 0;
+                queue[tail++] = cell;
+            }
+            CellMask unexplored = free & ~sources;
+            while (head < tail)
+            {
+                unsigned cell = queue[head++];
+                for (Action move : ActionRange(neighbour_moves<W>(unexplored, cell / W, cell % W)))
+                {
+                    unsigned next = neighbour_cell<W>(cell, move);
+                    distances[next] = distances[cell] + 1;
+                    unexplored &= ~cell_bit(next);
+                    queue[tail++] = next;
+                }
+            }
+        }
+
+    public:
+        explicit DistanceMapCache(unsigned size_log2 = 12) : entries(std::size_t(1) << size_log2) {};
+
+        const Distances &distances(CellMask free, CellMask targets)
+        {
+            Entry &entry = entries[hash(free, targets) & (entries.size() - 1)];
+            if (entry.valid && entry.free == free && entry.targets == targets)
+            {
+                bump(hit_count);
+                return entry.distances;
+            }
+            bump(miss_count);
+            entry.free = free;
+            entry.targets = targets;
+            entry.valid = true;
+            compute(free, targets, entry.distances);
+            return entry.distances;
+        }
+
+        // Same first move and distance as great_risks::shortest_path: the first neighbour in north,
+        // south, east, west order that is closest to a target is exactly the first step of the path
+        // a breadth-first search from (x, y) returns. x, y of the result is one of the nearest
+        // targets. The start cell must not be in `free`, as with a robot standing on it.
+        PathResult shortest_path(CellMask free, unsigned x, unsigned y, CellMask targets)
+        {
+            unsigned start = x * W + y;
+            if (has_cell(targets, start))
+            {
+                return {true, DO_NOTHING, static_cast<std::uint8_t>(x), static_cast<std::uint8_t>(y), 0};
+            }
+            const Distances &grid = distances(free, targets);
+            std::uint8_t best = UNREACHABLE;
+            Action first_move = DO_NOTHING;
+            for (Action move : ActionRange(neighbour_moves<W>(free, x, y)))
+            {
+                std::uint8_t distance = grid[neighbour_cell<W>(start, move)];
+                if (distance < best)
+                {
+                    best = distance;
+                    first_move = move;
+                }
+            }
+            if (best == UNREACHABLE)
+            {
+                return {false, DO_NOTHING, static_cast<std::uint8_t>(x), static_cast<std::uint8_t>(y), 0};
+            }
+            // walk down the grid to the target
+            unsigned cell = neighbour_cell<W>(start, first_move);
+            while (grid[cell] > 0)
+            {
+                for (Action move : ActionRange(neighbour_moves<W>(free, cell / W, cell % W)))
+                {
+                    unsigned next = neighbour_cell<W>(cell, move);
+                    if (grid[next] + 1 == grid[cell])
+                    {
+                        cell = next;
+                        break;
+                    }
+                }
+            }
+            return {true,
+                    first_move,
+                    static_cast<std::uint8_t>(cell / W),
+                    static_cast<std::uint8_t>(cell % W),
+                    static_cast<std::uint8_t>(best + 1)};
+        }
+
+        Stats stats() const
+        {
+            return {hit_count.load(std::memory_order_relaxed), miss_count.load(std::memory_order_relaxed)};
+        }
+    };
+}  // namespace great_risks
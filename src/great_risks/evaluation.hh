@@ -0,0 +1,66 @@
+#pragma once
+
+#include "simulator.hh"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace great_risks
+{
+    // Static estimate of the final red minus blue score, for playouts cut off before the end. It
+    // starts from calculate_scores() and adds half a point per carried ring for its colour. A
+    // held goal adds part of what doubling it in the nearest positive corner would gain its
+    // holder, less the further that corner is, and nothing once the corner can't be reached
+    // before it is protected. A goal already in a positive corner has a quarter of its points at
+    // risk until the corner is protected.
+    template <typename G>
+    float estimate_score_diff(const BasicField<G> &field)
+    {
+        constexpr float CARRIED_RING = 0.5;
+        constexpr float HELD_GOAL = 0.5;
+        constexpr float UNPROTECTED_CORNER_RISK = 0.25;
+
+        auto [red_score, blue_score] = field.calculate_scores();
+        float diff = red_score - blue_score;
+        // ticks left to put a goal into a positive corner or take one out
+        int open_time = field.time_remaining - G::PROTECTED_CORNER_TIME;
+        for (const Robot &robot : field.robots)
+        {
+            int blue_rings = __builtin_popcount(robot.rings.color_bits());
+            int red_rings = robot.rings.size() - blue_rings;
+            diff += CARRIED_RING * (red_rings - blue_rings);
+            if (robot.goal == NO_GOAL)
+            {
+                continue;
+            }
+            auto points = field.goal_points(robot.goal);
+            int goal_diff = points[RED] - points[BLUE];
+            if (robot.is_red ? goal_diff <= 0 : goal_diff >= 0)
+            {
+                continue;
+            }
+            int distance = open_time;
+            for (const auto &corner : G::POSITIVE_CORNERS)
+            {
+                distance = std::min(distance, std::abs(robot.x - corner[0]) + std::abs(robot.y - corner[1]));
+            }
+            if (distance < open_time)
+            {
+                diff += HELD_GOAL * goal_diff * (1 - static_cast<float>(distance) / open_time);
+            }
+        }
+        if (open_time > 0)
+        {
+            for (std::size_t i = 0; i < field.goals.size(); i++)
+            {
+                const MobileGoal &goal = field.goals[i];
+                if (goal.x != ON_ROBOT && field.corner_multiplier(goal.x, goal.y) == 2)
+                {
+                    auto points = field.goal_points(i);
+                    diff -= UNPROTECTED_CORNER_RISK * (points[RED] - points[BLUE]);
+                }
+            }
+        }
+        return diff;
+    }
+}  // namespace great_risks
@@ -0,0 +1,529 @@
+#include "field_batch.hh"
+
+#include "debug.hh"
+
+#include <algorithm>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace great_risks
+{
+    // ring stack codes, see RingStack::code()
+    constexpr int EMPTY_RINGS = 1;
+    constexpr int FULL_GOAL = 1 << MAX_GOAL_RINGS;
+    constexpr int FULL_STAKE = 1 << MAX_STAKE_RINGS;
+    constexpr int FULL_ROBOT = 1 << MAX_ROBOT_RINGS;
+
+    static_assert(sizeof(Action) == sizeof(std::int32_t), "step() loads actions as 32-bit lanes");
+
+    template <typename G>
+    BasicFieldBatch<G>::BasicFieldBatch(std::size_t size, const FieldType &field)
+      : count(size), stride((size + LANES - 1) / LANES * LANES), robot_count(field.robots.size())
+    {
+        robot_x.resize(G::MAX_ROBOTS * stride);
+        robot_y.resize(G::MAX_ROBOTS * stride);
+        robot_goal.resize(G::MAX_ROBOTS * stride);
+        robot_rings.resize(G::MAX_ROBOTS * stride);
+        robot_is_red.resize(G::MAX_ROBOTS * stride);
+        goal_x.resize(NUM_GOALS * stride);
+        goal_y.resize(NUM_GOALS * stride);
+        goal_rings.resize(NUM_GOALS * stride);
+        goal_tipped.resize(NUM_GOALS * stride);
+        stake_rings.resize(NUM_STAKES * stride);
+        // gathers read four bytes at a time, so the loose ring grids get three bytes of slack
+        red_rings.resize(WIDTH * WIDTH * stride + 3);
+        blue_rings.resize(WIDTH * WIDTH * stride + 3);
+        time_remaining.resize(stride);
+        keys.resize(stride);
+        red_scores.resize(stride);
+        blue_scores.resize(stride);
+        for (std::size_t game = 0; game < count; game++)
+        {
+            set(game, field);
+        }
+    }
+
+    template <typename G>
+    BasicField<G> BasicFieldBatch<G>::get(std::size_t game) const
+    {
+        FieldType field;
+        while (!field.robots.empty())
+        {
+            field.robots.pop_back();
+        }
+        for (std::size_t i = 0; i < robot_count; i++)
+        {
+            Robot robot;
+            robot.x = robot_x[i * stride + game];
+            robot.y = robot_y[i * stride + game];
+            robot.goal = robot_goal[i * stride + game];
+            robot.rings = RingStack<MAX_ROBOT_RINGS>::from_code(robot_rings[i * stride + game]);
+            robot.is_red = robot_is_red[i * stride + game];
+            field.robots.push_back(robot);
+        }
+        for (std::size_t i = 0; i < NUM_GOALS; i++)
+        {
+            field.goals[i].x = goal_x[i * stride + game];
+            field.goals[i].y = goal_y[i * stride + game];
+            field.goals[i].rings = RingStack<MAX_GOAL_RINGS>::from_code(goal_rings[i * stride + game]);
+            field.goals[i].tipped = goal_tipped[i * stride + game];
+        }
+        for (std::size_t i = 0; i < NUM_STAKES; i++)
+        {
+            field.stakes[i].rings = RingStack<MAX_STAKE_RINGS>::from_code(stake_rings[i * stride + game]);
+        }
+        for (std::size_t x = 0; x < WIDTH; x++)
+        {
+            for (std::size_t y = 0; y < WIDTH; y++)
+            {
+                field.red_rings[x][y] = red_rings[(x * WIDTH + y) * stride + game];
+                field.blue_rings[x][y] = blue_rings[(x * WIDTH + y) * stride + game];
+            }
+        }
+        field.time_remaining = time_remaining[game];
+        field.key = keys[game];
+        field.occupancy = robot_cells(field);
+        field.raw_scores = {red_scores[game], blue_scores[game]};
+        GREAT_RISKS_CHECK(field.key == zobrist_key(field));
+        return field;
+    }
+
+    template <typename G>
+    void BasicFieldBatch<G>::set(std::size_t game, const FieldType &field)
+    {
+        GREAT_RISKS_CHECK(field.robots.size() == robot_count);
+        for (std::size_t i = 0; i < robot_count; i++)
+        {
+            const Robot &robot = field.robots[i];
+            robot_x[i * stride + game] = robot.x;
+            robot_y[i * stride + game] = robot.y;
+            robot_goal[i * stride + game] = robot.goal;
+            robot_rings[i * stride + game] = robot.rings.code();
+            robot_is_red[i * stride + game] = robot.is_red;
+        }
+        for (std::size_t i = 0; i < NUM_GOALS; i++)
+        {
+            const MobileGoal &goal = field.goals[i];
+            goal_x[i * stride + game] = goal.x;
+            goal_y[i * stride + game] = goal.y;
+            goal_rings[i * stride + game] = goal.rings.code();
+            goal_tipped[i * stride + game] = goal.tipped;
+        }
+        for (std::size_t i = 0; i < NUM_STAKES; i++)
+        {
+            stake_rings[i * stride + game] = field.stakes[i].rings.code();
+        }
+        for (std::size_t x = 0; x < WIDTH; x++)
+        {
+            for (std::size_t y = 0; y < WIDTH; y++)
+            {
+                red_rings[(x * WIDTH + y) * stride + game] = field.red_rings[x][y];
+                blue_rings[(x * WIDTH + y) * stride + game] = field.blue_rings[x][y];
+            }
+        }
+        time_remaining[game] = field.time_remaining;
+        keys[game] = field.key;
+        red_scores[game] = field.raw_scores[RED];
+        blue_scores[game] = field.raw_scores[BLUE];
+    }
+
+    // same rules as BasicField::legal_action_mask(), read straight from the arrays
+    template <typename G>
+    ActionMask BasicFieldBatch<G>::legal_action_mask(std::size_t game, std::uint8_t i) const
+    {
+        int x = robot_x[i * stride + game];
+        int y = robot_y[i * stride + game];
+        int goal = robot_goal[i * stride + game];
+        int rings = robot_rings[i * stride + game];
+        bool is_red = robot_is_red[i * stride + game];
+        int time = time_remaining[game];
+        auto is_free = [&](int cx, int cy)
+        {
+            for (const auto &post : G::POSTS)
+            {
+                if (post[0] == cx && post[1] == cy)
+                {
+                    return false;
+                }
+            }
+            if (time > G::AUTONOMOUS_END && (is_red ? cy > WIDTH / 2 : cy < WIDTH / 2))
+            {
+                return false;
+            }
+            for (std::size_t j = 0; j < robot_count; j++)
+            {
+                if (j != i && robot_x[j * stride + game] == cx && robot_y[j * stride + game] == cy)
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+        ActionMask result = 0;
+        if (x > 0 && is_free(x - 1, y))
+        {
+            result |= action_bit(MOVE_NORTH);
+        }
+        if (x < WIDTH - 1 && is_free(x + 1, y))
+        {
+            result |= action_bit(MOVE_SOUTH);
+        }
+        if (y < WIDTH - 1 && is_free(x, y + 1))
+        {
+            result |= action_bit(MOVE_EAST);
+        }
+        if (y > 0 && is_free(x, y - 1))
+        {
+            result |= action_bit(MOVE_WEST);
+        }
+        bool protected_corner = FieldType::in_protected_corner(x, y, time);
+        std::size_t goal_here = NUM_GOALS;
+        for (std::size_t g = 0; g < NUM_GOALS; g++)
+        {
+            if (goal_x[g * stride + game] == x && goal_y[g * stride + game] == y)
+            {
+                goal_here = g;
+                break;
+            }
+        }
+        if (goal == NO_GOAL && goal_here != NUM_GOALS && !protected_corner)
+        {
+            if (goal_tipped[goal_here * stride + game])
+            {
+                result |= action_bit(UNTIP_MOBILE_GOAL);
+            }
+            else
+            {
+                result |= action_bit(GRAB_MOBILE_GOAL) | action_bit(TIP_MOBILE_GOAL);
+            }
+        }
+        else if (goal != NO_GOAL)
+        {
+            int held_rings = goal_rings[goal * stride + game];
+            if (goal_here == NUM_GOALS && !protected_corner)
+            {
+                result |= action_bit(RELEASE_MOBILE_GOAL);
+            }
+            if (rings != EMPTY_RINGS && held_rings < FULL_GOAL)
+            {
+                result |= action_bit(SCORE_MOBILE_GOAL);
+            }
+            if (held_rings != EMPTY_RINGS && rings < FULL_ROBOT)
+            {
+                result |= action_bit(DESCORE_MOBILE_GOAL);
+            }
+        }
+        if (rings < FULL_ROBOT)
+        {
+            if (red_rings[(x * WIDTH + y) * stride + game])
+            {
+                result |= action_bit(PICK_UP_RED);
+            }
+            if (blue_rings[(x * WIDTH + y) * stride + game])
+            {
+                result |= action_bit(PICK_UP_BLUE);
+            }
+        }
+        if (rings != EMPTY_RINGS)
+        {
+            result |= action_bit(RELEASE_RING);
+        }
+        for (std::size_t s = 0; s < NUM_STAKES; s++)
+        {
+            if (G::STAKES[s][0] == x && G::STAKES[s][1] == y)
+            {
+                int stake = stake_rings[s * stride + game];
+                if (rings != EMPTY_RINGS && stake < FULL_STAKE)
+                {
+                    result |= action_bit(SCORE_WALL_STAKE);
+                }
+                if (stake != EMPTY_RINGS && rings < FULL_ROBOT)
+                {
+                    result |= action_bit(DESCORE_WALL_STAKE);
+                }
+            }
+        }
+        if constexpr (G::CAN_DO_NOTHING)
+        {
+            result |= action_bit(DO_NOTHING);
+        }
+        return result;
+    }
+
+    template <typename G>
+    void BasicFieldBatch<G>::step(std::size_t game, std::uint8_t i, Action a)
+    {
+        if (a <= MOVE_WEST)
+        {
+            std::uint8_t &x = robot_x[i * stride + game];
+            std::uint8_t &y = robot_y[i * stride + game];
+            keys[game] ^= ZOBRIST.robot_cell[i][x * WIDTH + y];
+            x += a == MOVE_SOUTH ? 1 : a == MOVE_NORTH ? -1 : 0;
+            y += a == MOVE_EAST ? 1 : a == MOVE_WEST ? -1 : 0;
+            keys[game] ^= ZOBRIST.robot_cell[i][x * WIDTH + y];
+        }
+        else if (a != DO_NOTHING)
+        {
+            FieldType field = get(game);
+            field.perform_action(i, a);
+            set(game, field);
+        }
+    }
+
+#ifdef __AVX2__
+    // eight bytes widened to one 32-bit lane each
+    inline __m256i load_lanes(const std::uint8_t *p)
+    {
+        return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+    }
+
+    // low byte of each 32-bit lane, values must fit in a byte
+    inline void store_lanes(std::uint8_t *p, __m256i v)
+    {
+        __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(p), _mm_packus_epi16(words, words));
+    }
+
+    inline __m256i lanes(int value)
+    {
+        return _mm256_set1_epi32(value);
+    }
+
+    // a & ~b
+    inline __m256i and_not(__m256i a, __m256i b)
+    {
+        return _mm256_andnot_si256(b, a);
+    }
+
+    inline __m256i equal(__m256i a, __m256i b)
+    {
+        return _mm256_cmpeq_epi32(a, b);
+    }
+
+    inline __m256i greater(__m256i a, __m256i b)
+    {
+        return _mm256_cmpgt_epi32(a, b);
+    }
+
+    inline __m256i action_if(__m256i condition, Action a)
+    {
+        return condition & lanes(action_bit(a));
+    }
+#endif
+
+    template <typename G>
+    void BasicFieldBatch<G>::legal_action_masks(std::uint8_t i, ActionMask *out) const
+    {
+        std::size_t game = 0;
+#ifdef __AVX2__
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i one = lanes(1);
+        for (; game + LANES <= count; game += LANES)
+        {
+            __m256i x = load_lanes(&robot_x[i * stride + game]);
+            __m256i y = load_lanes(&robot_y[i * stride + game]);
+            __m256i goal = load_lanes(&robot_goal[i * stride + game]);
+            __m256i rings = load_lanes(&robot_rings[i * stride + game]);
+            __m256i is_red = equal(load_lanes(&robot_is_red[i * stride + game]), one);
+            __m256i time = load_lanes(&time_remaining[game]);
+            __m256i other_x[G::MAX_ROBOTS];
+            __m256i other_y[G::MAX_ROBOTS];
+            for (std::size_t j = 0; j < robot_count; j++)
+            {
+                other_x[j] = load_lanes(&robot_x[j * stride + game]);
+                other_y[j] = load_lanes(&robot_y[j * stride + game]);
+            }
+            auto blocked = [&](__m256i cx, __m256i cy)
+            {
+                __m256i result = zero;
+                for (const auto &post : G::POSTS)
+                {
+                    result = result | (equal(cx, lanes(post[0])) & equal(cy, lanes(post[1])));
+                }
+                for (std::size_t j = 0; j < robot_count; j++)
+                {
+                    if (j != i)
+                    {
+                        result = result | (equal(cx, other_x[j]) & equal(cy, other_y[j]));
+                    }
+                }
+                if constexpr (G::AUTONOMOUS_END < G::START_TIME)
+                {
+                    __m256i wrong_half = _mm256_blendv_epi8(
+                        greater(lanes(WIDTH / 2), cy), greater(cy, lanes(WIDTH / 2)), is_red);
+                    result = result | (greater(time, lanes(G::AUTONOMOUS_END)) & wrong_half);
+                }
+                return result;
+            };
+            __m256i last = lanes(WIDTH - 1);
+            __m256i result = action_if(and_not(greater(x, zero), blocked(_mm256_sub_epi32(x, one), y)), MOVE_NORTH);
+            result = result | action_if(and_not(greater(last, x), blocked(_mm256_add_epi32(x, one), y)), MOVE_SOUTH);
+            result = result | action_if(and_not(greater(last, y), blocked(x, _mm256_add_epi32(y, one))), MOVE_EAST);
+            result = result | action_if(and_not(greater(y, zero), blocked(x, _mm256_sub_epi32(y, one))), MOVE_WEST);
+
+            // goals are blended in reverse so the first goal on the cell wins, as in the scalar code
+            __m256i goal_here = zero;
+            __m256i tipped_here = zero;
+            __m256i held_rings = zero;
+            for (std::size_t g = NUM_GOALS; g-- > 0;)
+            {
+                __m256i here =
+                    equal(load_lanes(&goal_x[g * stride + game]), x) & equal(load_lanes(&goal_y[g * stride + game]), y);
+                goal_here = goal_here | here;
+                tipped_here = _mm256_blendv_epi8(tipped_here, equal(load_lanes(&goal_tipped[g * stride + game]), one), here);
+                held_rings = _mm256_blendv_epi8(
+                    held_rings, load_lanes(&goal_rings[g * stride + game]), equal(goal, lanes(g)));
+            }
+            __m256i protected_corner = zero;
+            if constexpr (G::PROTECTED_CORNER_TIME >= 0)
+            {
+                for (const auto &corner : G::POSITIVE_CORNERS)
+                {
+                    protected_corner = protected_corner | (equal(x, lanes(corner[0])) & equal(y, lanes(corner[1])));
+                }
+                protected_corner = protected_corner & greater(lanes(G::PROTECTED_CORNER_TIME + 1), time);
+            }
+            __m256i hands_free = equal(goal, lanes(NO_GOAL));
+            __m256i holding = and_not(lanes(-1), hands_free);
+            __m256i can_grab = and_not(hands_free & goal_here, protected_corner);
+            result = result | action_if(can_grab & tipped_here, UNTIP_MOBILE_GOAL);
+            result = result | action_if(and_not(can_grab, tipped_here), GRAB_MOBILE_GOAL);
+            result = result | action_if(and_not(can_grab, tipped_here), TIP_MOBILE_GOAL);
+            __m256i has_rings = greater(rings, lanes(EMPTY_RINGS));
+            __m256i room_for_ring = greater(lanes(FULL_ROBOT), rings);
+            result = result | action_if(and_not(holding, goal_here | protected_corner), RELEASE_MOBILE_GOAL);
+            result = result | action_if(holding & has_rings & greater(lanes(FULL_GOAL), held_rings), SCORE_MOBILE_GOAL);
+            result = result | action_if(holding & room_for_ring & greater(held_rings, lanes(EMPTY_RINGS)), DESCORE_MOBILE_GOAL);
+
+            __m256i cell = _mm256_add_epi32(_mm256_mullo_epi32(x, lanes(WIDTH)), y);
+            __m256i index = _mm256_add_epi32(
+                _mm256_mullo_epi32(cell, lanes(stride)), _mm256_add_epi32(lanes(game), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+            __m256i red_here = _mm256_i32gather_epi32(reinterpret_cast<const int *>(red_rings.data()), index, 1) & lanes(0xff);
+            __m256i blue_here = _mm256_i32gather_epi32(reinterpret_cast<const int *>(blue_rings.data()), index, 1) & lanes(0xff);
+            result = result | action_if(and_not(room_for_ring, equal(red_here, zero)), PICK_UP_RED);
+            result = result | action_if(and_not(room_for_ring, equal(blue_here, zero)), PICK_UP_BLUE);
+            result = result | action_if(has_rings, RELEASE_RING);
+            for (std::size_t s = 0; s < NUM_STAKES; s++)
+            {
+                __m256i at_stake = equal(x, lanes(G::STAKES[s][0])) & equal(y, lanes(G::STAKES[s][1]));
+                __m256i stake = load_lanes(&stake_rings[s * stride + game]);
+                result = result | action_if(at_stake & has_rings & greater(lanes(FULL_STAKE), stake), SCORE_WALL_STAKE);
+                result = result | action_if(at_stake & room_for_ring & greater(stake, lanes(EMPTY_RINGS)), DESCORE_WALL_STAKE);
+            }
+            if constexpr (G::CAN_DO_NOTHING)
+            {
+                result = result | lanes(action_bit(DO_NOTHING));
+            }
+            __m128i masks = _mm_packus_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + game), masks);
+        }
+#endif
+        for (; game < count; game++)
+        {
+            out[game] = legal_action_mask(game, i);
+        }
+#ifdef GREAT_RISKS_DEBUG_CHECKS
+        for (std::size_t game = 0; game < count; game++)
+        {
+            GREAT_RISKS_CHECK(out[game] == legal_action_mask(game, i));
+            GREAT_RISKS_CHECK(out[game] == get(game).legal_action_mask(i));
+        }
+#endif
+    }
+
+    template <typename G>
+    void BasicFieldBatch<G>::step(std::uint8_t i, const Action *actions)
+    {
+#ifdef GREAT_RISKS_DEBUG_CHECKS
+        std::vector<FieldType> expected;
+        for (std::size_t game = 0; game < count; game++)
+        {
+            expected.push_back(get(game));
+            expected.back().perform_action(i, actions[game]);
+        }
+#endif
+        std::size_t game = 0;
+#ifdef __AVX2__
+        const auto *cell_keys = reinterpret_cast<const long long *>(ZOBRIST.robot_cell[i].data());
+        for (; game + LANES <= count; game += LANES)
+        {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(actions + game));
+            __m256i x = load_lanes(&robot_x[i * stride + game]);
+            __m256i y = load_lanes(&robot_y[i * stride + game]);
+            // comparisons give -1, so adding the north mask and subtracting the south one moves x
+            __m256i new_x = _mm256_sub_epi32(_mm256_add_epi32(x, equal(a, lanes(MOVE_NORTH))), equal(a, lanes(MOVE_SOUTH)));
+            __m256i new_y = _mm256_sub_epi32(_mm256_add_epi32(y, equal(a, lanes(MOVE_WEST))), equal(a, lanes(MOVE_EAST)));
+            // robots that did not move XOR the same key in and out
+            __m256i old_cell = _mm256_add_epi32(_mm256_mullo_epi32(x, lanes(WIDTH)), y);
+            __m256i new_cell = _mm256_add_epi32(_mm256_mullo_epi32(new_x, lanes(WIDTH)), new_y);
+            for (std::size_t half = 0; half < 2; half++)
+            {
+                __m128i old_half = half ? _mm256_extracti128_si256(old_cell, 1) : _mm256_castsi256_si128(old_cell);
+                __m128i new_half = half ? _mm256_extracti128_si256(new_cell, 1) : _mm256_castsi256_si128(new_cell);
+                auto *key = reinterpret_cast<__m256i *>(&keys[game + 4 * half]);
+                __m256i delta = _mm256_xor_si256(
+                    _mm256_i32gather_epi64(cell_keys, old_half, 8), _mm256_i32gather_epi64(cell_keys, new_half, 8));
+                _mm256_storeu_si256(key, _mm256_xor_si256(_mm256_loadu_si256(key), delta));
+            }
+            store_lanes(&robot_x[i * stride + game], new_x);
+            store_lanes(&robot_y[i * stride + game], new_y);
+            // everything but moves and waiting is left to the scalar code
+            __m256i simple = greater(lanes(MOVE_WEST + 1), a) | equal(a, lanes(DO_NOTHING));
+            unsigned rest = ~_mm256_movemask_ps(_mm256_castsi256_ps(simple)) & 0xff;
+            for (; rest; rest &= rest - 1)
+            {
+                std::size_t lane = game + __builtin_ctz(rest);
+                step(lane, i, actions[lane]);
+            }
+        }
+#endif
+        for (; game < count; game++)
+        {
+            step(game, i, actions[game]);
+        }
+#ifdef GREAT_RISKS_DEBUG_CHECKS
+        for (std::size_t game = 0; game < count; game++)
+        {
+            FieldType actual = get(game);
+            GREAT_RISKS_CHECK(actual == expected[game]);
+            GREAT_RISKS_CHECK(actual.raw_scores == expected[game].raw_scores);
+        }
+#endif
+    }
+
+    template <typename G>
+    void BasicFieldBatch<G>::tick()
+    {
+        for (std::size_t game = 0; game < count; game++)
+        {
+            keys[game] ^= zobrist_time(time_remaining[game]);
+            time_remaining[game]--;
+            keys[game] ^= zobrist_time(time_remaining[game]);
+        }
+    }
+
+    template <typename G>
+    void BasicFieldBatch<G>::scores(int *red, int *blue) const
+    {
+        std::size_t game = 0;
+#ifdef __AVX2__
+        for (; game + LANES <= count; game += LANES)
+        {
+            __m256i red_raw = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&red_scores[game]));
+            __m256i blue_raw = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&blue_scores[game]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(red + game), _mm256_max_epi32(red_raw, _mm256_setzero_si256()));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(blue + game), _mm256_max_epi32(blue_raw, _mm256_setzero_si256()));
+        }
+#endif
+        for (; game < count; game++)
+        {
+            red[game] = std::max(red_scores[game], 0);
+            blue[game] = std::max(blue_scores[game], 0);
+        }
+    }
+
+    template class BasicFieldBatch<FieldGeometry>;
+    template class BasicFieldBatch<ReducedGeometry>;
+}  // namespace great_risks
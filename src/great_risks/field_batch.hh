@@ -0,0 +1,78 @@
+#pragma once
+
+#include "reduced_game.hh"
+#include "simulator.hh"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace great_risks
+{
+    // Many games of the same field variant stored as a structure of arrays, so one call can
+    // compute legal actions for, step and score every game. Per-component arrays are indexed as
+    // [component * stride + game] and ring stacks are stored by their code(). All games must have
+    // the same number of robots. With AVX2 the kernels handle eight games per instruction, other
+    // builds and the last few games go through the scalar per-game code. Moves are stepped in
+    // place, every other action goes through BasicField::perform_action on an unpacked copy.
+    template <typename G>
+    class BasicFieldBatch
+    {
+    public:
+        using FieldType = BasicField<G>;
+        static constexpr std::uint8_t WIDTH = G::WIDTH;
+        static constexpr std::size_t NUM_GOALS = G::GOALS.size();
+        static constexpr std::size_t NUM_STAKES = G::STAKES.size();
+        static constexpr std::size_t LANES = 8;
+
+    private:
+        std::size_t count;
+        std::size_t stride;
+        std::uint8_t robot_count;
+
+        std::vector<std::uint8_t> robot_x;
+        std::vector<std::uint8_t> robot_y;
+        std::vector<std::uint8_t> robot_goal;
+        std::vector<std::uint8_t> robot_rings;
+        std::vector<std::uint8_t> robot_is_red;
+        std::vector<std::uint8_t> goal_x;
+        std::vector<std::uint8_t> goal_y;
+        std::vector<std::uint8_t> goal_rings;
+        std::vector<std::uint8_t> goal_tipped;
+        std::vector<std::uint8_t> stake_rings;
+        std::vector<std::uint8_t> red_rings;
+        std::vector<std::uint8_t> blue_rings;
+        std::vector<std::uint8_t> time_remaining;
+        std::vector<std::uint64_t> keys;
+        std::vector<std::int32_t> red_scores;
+        std::vector<std::int32_t> blue_scores;
+
+        ActionMask legal_action_mask(std::size_t game, std::uint8_t i) const;
+        void step(std::size_t game, std::uint8_t i, Action a);
+
+    public:
+        // `size` copies of `field`
+        BasicFieldBatch(std::size_t size, const FieldType &field);
+
+        std::size_t size() const
+        {
+            return count;
+        }
+
+        FieldType get(std::size_t game) const;
+        void set(std::size_t game, const FieldType &field);
+
+        // legal actions of robot i in every game, out needs room for size() masks
+        void legal_action_masks(std::uint8_t i, ActionMask *out) const;
+        // performs actions[game] for robot i in every game, actions must be legal
+        void step(std::uint8_t i, const Action *actions);
+        void tick();
+        // clamped scores of every game, as calculate_scores() would return them
+        void scores(int *red, int *blue) const;
+    };
+
+    using FieldBatch = BasicFieldBatch<FieldGeometry>;
+    using ReducedFieldBatch = BasicFieldBatch<ReducedGeometry>;
+    extern template class BasicFieldBatch<FieldGeometry>;
+    extern template class BasicFieldBatch<ReducedGeometry>;
+}  // namespace great_risks
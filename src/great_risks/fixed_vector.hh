@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace great_risks
+{
+    // Vector with inline storage for at most N elements, trivially copyable when T is.
+    template <typename T, std::size_t N>
+    class FixedVector
+    {
+        static_assert(N <= 255, "size must fit in a single byte");
+
+    private:
+        std::array<T, N> items = {};
+        std::uint8_t count = 0;
+
+    public:
+        static constexpr std::size_t capacity()
+        {
+            return N;
+        }
+
+        std::size_t size() const
+        {
+            return count;
+        }
+
+        bool empty() const
+        {
+            return count == 0;
+        }
+
+        bool full() const
+        {
+            return count == N;
+        }
+
+        T &operator[](std::size_t i)
+        {
+            return items[i];
+        }
+
+        const T &operator[](std::size_t i) const
+        {
+            return items[i];
+        }
+
+        T &back()
+        {
+            return items[count - 1];
+        }
+
+        const T &back() const
+        {
+            return items[count - 1];
+        }
+
+        void push_back(const T &item)
+        {
+            items[count++] = item;
+        }
+
+        void pop_back()
+        {
+            count--;
+        }
+
+        T *begin()
+        {
+            return items.data();
+        }
+
+        T *end()
+        {
+            return items.data() + count;
+        }
+
+        const T *begin() const
+        {
+            return items.data();
+        }
+
+        const T *end() const
+        {
+            return items.data() + count;
+        }
+
+        bool operator==(const FixedVector &other) const
+        {
+            if (count != other.count)
+            {
+                return false;
+            }
+            for (std::size_t i = 0; i < count; i++)
+            {
+                if (!(items[i] == other.items[i]))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool operator!=(const FixedVector &other) const
+        {
+            return !(*this == other);
+        }
+    };
+}  // namespace great_risks
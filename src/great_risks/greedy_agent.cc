@@ -1,45 +1,140 @@
 #include "greedy_agent.hh"
 
+#include "thread_pool.hh"
+
 #include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include <pthread.h>
 
 namespace great_risks
 {
-    Action GreedyAgent::next_action(Field field)
+    namespace
+    {
+        using DistanceMaps = DistanceMapCache<Field::WIDTH>;
+
+        // the maps of every live thread, and the counts of those that have exited
+        struct DistanceMapRegistry
+        {
+            std::mutex mutex;
+            std::vector<const DistanceMaps *> live;
+            DistanceMaps::Stats retired;
+        };
+
+        DistanceMapRegistry &registry()
+        {
+            // never destroyed, pool threads still unregister while the global pool shuts down
+            static DistanceMapRegistry &maps = *new DistanceMapRegistry;
+            // a child forked while another thread registers would otherwise find the mutex held
+            static const int fork_handlers = pthread_atfork([] { maps.mutex.lock(); },
+                                                            [] { maps.mutex.unlock(); },
+                                                            [] { maps.mutex.unlock(); });
+            (void)fork_handlers;
+            return maps;
+        }
+
+        struct ThreadDistanceMaps
+        {
+            DistanceMaps maps;
+
+            ThreadDistanceMaps()
+            {
+                DistanceMapRegistry &r = registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                r.live.push_back(&maps);
+            }
+
+            ~ThreadDistanceMaps()
+            {
+                DistanceMapRegistry &r = registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                DistanceMaps::Stats stats = maps.stats();
+                r.retired.hits += stats.hits;
+                r.retired.misses += stats.misses;
+                r.live.erase(std::find(r.live.begin(), r.live.end(), &maps));
+            }
+        };
+
+        // MCTS workers share agent objects, so every thread keeps its own distance maps. Rollouts
+        // revisit the same robot positions and targets often enough for the grids to pay off.
+        thread_local ThreadDistanceMaps distance_maps;
+    }  // namespace
+
+    PathResult path_towards(const Field &field, const Robot &robot, CellMask targets)
+    {
+        return distance_maps.maps.shortest_path(field.free_cells(robot.is_red), robot.x, robot.y, targets);
+    }
+
+    DistanceMapCache<Field::WIDTH>::Stats GreedyAgent::distance_map_stats()
+    {
+        DistanceMapRegistry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        DistanceMaps::Stats total = r.retired;
+        for (const DistanceMaps *maps : r.live)
+        {
+            DistanceMaps::Stats stats = maps->stats();
+            total.hits += stats.hits;
+            total.misses += stats.misses;
+        }
+        return total;
+    }
+
+    void GreedyAgent::next_actions(const Field *fields, std::size_t count, Action *actions)
+    {
+        // fields per task, fewer aren't worth the scheduling
+        constexpr std::size_t CHUNK = 64;
+        ThreadPool &pool = ThreadPool::global();
+        ThreadPool::TaskGroup chunks;
+        for (std::size_t begin = 0; begin < count; begin += CHUNK)
+        {
+            std::size_t end = std::min(begin + CHUNK, count);
+            pool.submit(
+                chunks,
+                [this, fields, actions, begin, end]
+                {
+                    for (std::size_t i = begin; i < end; i++)
+                    {
+                        actions[i] = next_action(fields[i]);
+                    }
+                });
+        }
+        pool.wait(chunks);
+    }
+
+    Action GreedyAgent::next_action(const Field &field)
     {
         Robot robot_state = field.robots[robot_index];
-        auto legal_actions = field.legal_actions(robot_index);
+        ActionMask legal_actions = field.legal_action_mask(robot_index);
         // if there is no goal, go towards goal
         if (robot_state.goal == NO_GOAL)
         {
-            std::unordered_set<std::array<std::uint8_t, 2>> grabbable_goals;
+            CellMask grabbable_goals = 0;
             for (const auto &goal : field.goals)
             {
-                if (goal.x != ON_ROBOT && !in_protected_corner(goal.x, goal.y, field.time_remaining) &&
-                    !goal.tipped && goal.rings.size() < 6)
+                if (goal.x != ON_ROBOT && !Field::in_protected_corner(goal.x, goal.y, field.time_remaining) &&
+                    !goal.tipped && !goal.rings.full())
                 {
-                    grabbable_goals.insert({goal.x, goal.y});
+                    grabbable_goals |= cell_bit(goal.x * Field::WIDTH + goal.y);
                 }
             }
-            auto search_result =
-                field.shortest_path({robot_state.x, robot_state.y}, grabbable_goals, robot_state.is_red);
+            PathResult search_result =
+                path_towards(field, robot_state, grabbable_goals);
             // if we can grab a goal, grab it
-            if (search_result.second.empty() && !grabbable_goals.empty() &&
-                std::find(legal_actions.begin(), legal_actions.end(), GRAB_MOBILE_GOAL) !=
-                    legal_actions.end())
+            if (search_result.distance == 0 && grabbable_goals && has_action(legal_actions, GRAB_MOBILE_GOAL))
             {
                 return GRAB_MOBILE_GOAL;
             }
-            if (!search_result.second.empty())
+            if (search_result.distance > 0)
             {
-                return search_result.second[0];
+                return search_result.first_move;
             }
         }
         else if (robot_state.goal != NO_GOAL)
         {
             auto goal = field.goals[robot_state.goal];
             // if we can score more rings on the goal
-            if (std::find(legal_actions.begin(), legal_actions.end(), SCORE_MOBILE_GOAL) !=
-                legal_actions.end())
+            if (has_action(legal_actions, SCORE_MOBILE_GOAL))
             {
                 return SCORE_MOBILE_GOAL;
             }
@@ -57,28 +152,25 @@ namespace great_risks
                 }
             }
             // get state of positive corners
-            std::unordered_set<std::array<std::uint8_t, 2>> positive_corners;
+            CellMask positive_corners = 0;
             if (!left_corner_occupied && field.time_remaining > 15)
             {
-                positive_corners.insert({10, 0});
+                positive_corners |= cell_bit(10 * Field::WIDTH + 0);
             }
             if (!right_corner_occupied && field.time_remaining > 15)
             {
-                positive_corners.insert({10, 10});
+                positive_corners |= cell_bit(10 * Field::WIDTH + 10);
             }
             // otherwise try to release goal in positive corner
-            if (goal.rings.size() == 6 && !positive_corners.empty())
+            if (goal.rings.full() && positive_corners)
             {
-                auto search_result =
-                    field.shortest_path({robot_state.x, robot_state.y}, positive_corners, robot_state.is_red);
-                if (!search_result.second.empty())
+                PathResult search_result =
+                    path_towards(field, robot_state, positive_corners);
+                if (search_result.distance > 0)
                 {
-                    return search_result.second[0];
+                    return search_result.first_move;
                 }
-                else if (
-                    positive_corners.find(search_result.first) != positive_corners.end() &&
-                    std::find(legal_actions.begin(), legal_actions.end(), RELEASE_MOBILE_GOAL) !=
-                        legal_actions.end())
+                else if (search_result.found && has_action(legal_actions, RELEASE_MOBILE_GOAL))
                 {
                     // only release goal in positive corner, otherwise keep goal on robot
                     return RELEASE_MOBILE_GOAL;
@@ -87,62 +179,59 @@ namespace great_risks
         }
         if (robot_state.rings.size() > 0)
         {
-            std::unordered_set<std::array<std::uint8_t, 2>> stakes;
-            if (field.stakes[0].rings.size() < 6)
+            CellMask stakes = 0;
+            if (!field.stakes[0].rings.full())
             {
-                stakes.insert({0, 5});
+                stakes |= cell_bit(0 * Field::WIDTH + 5);
             }
-            if (field.stakes[1].rings.size() < 6)
+            if (!field.stakes[1].rings.full())
             {
-                stakes.insert({10, 5});
+                stakes |= cell_bit(10 * Field::WIDTH + 5);
             }
-            auto search_result =
-                field.shortest_path({robot_state.x, robot_state.y}, stakes, robot_state.is_red);
-            if (!search_result.second.empty())
+            PathResult search_result =
+                path_towards(field, robot_state, stakes);
+            if (search_result.distance > 0)
             {
-                return search_result.second[0];
+                return search_result.first_move;
             }
         }
         // if we can score on wall stake
-        if (std::find(legal_actions.begin(), legal_actions.end(), SCORE_WALL_STAKE) != legal_actions.end())
+        if (has_action(legal_actions, SCORE_WALL_STAKE))
         {
             return SCORE_WALL_STAKE;
         }
-        if (robot_state.is_red &&
-            std::find(legal_actions.begin(), legal_actions.end(), PICK_UP_RED) != legal_actions.end())
+        if (robot_state.is_red && has_action(legal_actions, PICK_UP_RED))
         {
             return PICK_UP_RED;
         }
-        if (!robot_state.is_red &&
-            std::find(legal_actions.begin(), legal_actions.end(), PICK_UP_BLUE) != legal_actions.end())
+        if (!robot_state.is_red && has_action(legal_actions, PICK_UP_BLUE))
         {
             return PICK_UP_BLUE;
         }
-        std::unordered_set<std::array<std::uint8_t, 2>> grabbable_rings;
+        CellMask grabbable_rings = 0;
         for (uint8_t i = 0; i < 11; i++)
         {
             for (uint8_t j = 0; j < 11; j++)
             {
-                std::array<std::uint8_t, 2> ring_pos = {i, j};
                 if (robot_state.is_red && field.red_rings[i][j])
                 {
-                    grabbable_rings.insert(ring_pos);
+                    grabbable_rings |= cell_bit(i * Field::WIDTH + j);
                 }
                 else if (!robot_state.is_red && field.blue_rings[i][j])
                 {
-                    grabbable_rings.insert(ring_pos);
+                    grabbable_rings |= cell_bit(i * Field::WIDTH + j);
                 }
             }
         }
-        if (!grabbable_rings.empty())
+        if (grabbable_rings)
         {
-            auto search_result =
-                field.shortest_path({robot_state.x, robot_state.y}, grabbable_rings, robot_state.is_red);
-            if (!search_result.second.empty())
+            PathResult search_result =
+                path_towards(field, robot_state, grabbable_rings);
+            if (search_result.distance > 0)
             {
-                return search_result.second[0];
+                return search_result.first_move;
             }
         }
-        return legal_actions[0];
+        return first_action(legal_actions);
     }
 }  // namespace great_risks
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "agent.hh"
+#include "distance_map.hh"
 
 namespace great_risks
 {
@@ -10,6 +11,11 @@ namespace great_risks
 
     public:
         ~GreedyAgent() override = default;
-        Action next_action(Field field) override;
+        Action next_action(const Field &field) override;
+        // chunks of the fields are decided in parallel on the global thread pool
+        void next_actions(const Field *fields, std::size_t count, Action *actions) override;
+
+        // lookups of the distance maps of every thread, summed over the process
+        static DistanceMapCache<Field::WIDTH>::Stats distance_map_stats();
     };
 }  // namespace great_risks
\ No newline at end of file
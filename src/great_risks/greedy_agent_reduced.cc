@@ -1,44 +1,39 @@
 #include "greedy_agent_reduced.hh"
 
-#include <algorithm>
-
 namespace great_risks
 {
-    Action GreedyAgentReduced::next_action(ReducedField field)
+    Action GreedyAgentReduced::next_action(const ReducedField &field)
     {
         Robot robot_state = field.robots[robot_index];
-        auto legal_actions = field.legal_actions(robot_index);
+        ActionMask legal_actions = field.legal_action_mask(robot_index);
         // if there is no goal, go towards goal
         if (robot_state.goal == NO_GOAL)
         {
-            std::unordered_set<std::array<std::uint8_t, 2>> grabbable_goals;
+            CellMask grabbable_goals = 0;
             for (auto &goal : field.goals)
             {
-                if (goal.x != ON_ROBOT && !goal.tipped && goal.rings.size() < 6)
+                if (goal.x != ON_ROBOT && !goal.tipped && !goal.rings.full())
                 {
-                    grabbable_goals.insert({goal.x, goal.y});
+                    grabbable_goals |= cell_bit(goal.x * ReducedField::WIDTH + goal.y);
                 }
             }
-            auto search_result =
+            PathResult search_result =
                 field.shortest_path({robot_state.x, robot_state.y}, grabbable_goals, robot_state.is_red);
             // if we can grab a goal, grab it
-            if (search_result.second.empty() && !grabbable_goals.empty() &&
-                std::find(legal_actions.begin(), legal_actions.end(), GRAB_MOBILE_GOAL) !=
-                    legal_actions.end())
+            if (search_result.distance == 0 && grabbable_goals && has_action(legal_actions, GRAB_MOBILE_GOAL))
             {
                 return GRAB_MOBILE_GOAL;
             }
-            if (!search_result.second.empty())
+            if (search_result.distance > 0)
             {
-                return search_result.second[0];
+                return search_result.first_move;
             }
         }
         else if (robot_state.goal != NO_GOAL)
         {
             auto goal = field.goals[robot_state.goal];
             // if we can score more rings on the goal
-            if (std::find(legal_actions.begin(), legal_actions.end(), SCORE_MOBILE_GOAL) !=
-                legal_actions.end())
+            if (has_action(legal_actions, SCORE_MOBILE_GOAL))
             {
                 return SCORE_MOBILE_GOAL;
             }
@@ -56,28 +51,25 @@ namespace great_risks
                 }
             }
             // get state of positive corners
-            std::unordered_set<std::array<std::uint8_t, 2>> positive_corners;
+            CellMask positive_corners = 0;
             if (!left_corner_occupied)
             {
-                positive_corners.insert({4, 0});
+                positive_corners |= cell_bit(4 * ReducedField::WIDTH + 0);
             }
             if (!right_corner_occupied)
             {
-                positive_corners.insert({4, 4});
+                positive_corners |= cell_bit(4 * ReducedField::WIDTH + 4);
             }
             // otherwise try to release goal in positive corner
-            if (goal.rings.size() == 6 && !positive_corners.empty())
+            if (goal.rings.full() && positive_corners)
             {
-                auto search_result =
+                PathResult search_result =
                     field.shortest_path({robot_state.x, robot_state.y}, positive_corners, robot_state.is_red);
-                if (!search_result.second.empty())
+                if (search_result.distance > 0)
                 {
-                    return search_result.second[0];
+                    return search_result.first_move;
                 }
-                else if (
-                    positive_corners.find(search_result.first) != positive_corners.end() &&
-                    std::find(legal_actions.begin(), legal_actions.end(), RELEASE_MOBILE_GOAL) !=
-                        legal_actions.end())
+                else if (search_result.found && has_action(legal_actions, RELEASE_MOBILE_GOAL))
                 {
                     // only release goal in positive corner, otherwise keep goal on robot
                     return RELEASE_MOBILE_GOAL;
@@ -86,62 +78,59 @@ namespace great_risks
         }
         if (robot_state.rings.size() > 0)
         {
-            std::unordered_set<std::array<std::uint8_t, 2>> stakes;
-            if (field.stakes[0].rings.size() < 6)
+            CellMask stakes = 0;
+            if (!field.stakes[0].rings.full())
             {
-                stakes.insert({0, 2});
+                stakes |= cell_bit(0 * ReducedField::WIDTH + 2);
             }
-            if (field.stakes[1].rings.size() < 6)
+            if (!field.stakes[1].rings.full())
             {
-                stakes.insert({4, 2});
+                stakes |= cell_bit(4 * ReducedField::WIDTH + 2);
             }
-            auto search_result =
+            PathResult search_result =
                 field.shortest_path({robot_state.x, robot_state.y}, stakes, robot_state.is_red);
-            if (!search_result.second.empty())
+            if (search_result.distance > 0)
             {
-                return search_result.second[0];
+                return search_result.first_move;
             }
         }
         // if we can score on wall stake
-        if (std::find(legal_actions.begin(), legal_actions.end(), SCORE_WALL_STAKE) != legal_actions.end())
+        if (has_action(legal_actions, SCORE_WALL_STAKE))
         {
             return SCORE_WALL_STAKE;
         }
-        if (robot_state.is_red &&
-            std::find(legal_actions.begin(), legal_actions.end(), PICK_UP_RED) != legal_actions.end())
+        if (robot_state.is_red && has_action(legal_actions, PICK_UP_RED))
         {
             return PICK_UP_RED;
         }
-        if (!robot_state.is_red &&
-            std::find(legal_actions.begin(), legal_actions.end(), PICK_UP_BLUE) != legal_actions.end())
+        if (!robot_state.is_red && has_action(legal_actions, PICK_UP_BLUE))
         {
             return PICK_UP_BLUE;
         }
-        std::unordered_set<std::array<std::uint8_t, 2>> grabbable_rings;
+        CellMask grabbable_rings = 0;
         for (uint8_t i = 0; i < 5; i++)
         {
             for (uint8_t j = 0; j < 5; j++)
             {
-                std::array<std::uint8_t, 2> ring_pos = {i, j};
                 if (robot_state.is_red && field.red_rings[i][j])
                 {
-                    grabbable_rings.insert(ring_pos);
+                    grabbable_rings |= cell_bit(i * ReducedField::WIDTH + j);
                 }
                 else if (!robot_state.is_red && field.blue_rings[i][j])
                 {
-                    grabbable_rings.insert(ring_pos);
+                    grabbable_rings |= cell_bit(i * ReducedField::WIDTH + j);
                 }
             }
         }
-        if (!grabbable_rings.empty())
+        if (grabbable_rings)
         {
-            auto search_result =
+            PathResult search_result =
                 field.shortest_path({robot_state.x, robot_state.y}, grabbable_rings, robot_state.is_red);
-            if (!search_result.second.empty())
+            if (search_result.distance > 0)
             {
-                return search_result.second[0];
+                return search_result.first_move;
             }
         }
-        return legal_actions[0];
+        return first_action(legal_actions);
     }
 }  // namespace great_risks
\ No newline at end of file
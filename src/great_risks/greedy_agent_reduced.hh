@@ -9,6 +9,6 @@ namespace great_risks
         using ReducedAgent::ReducedAgent;
 
     public:
-        Action next_action(ReducedField field) override;
+        Action next_action(const ReducedField &field) override;
     };
 }  // namespace great_risks
\ No newline at end of file
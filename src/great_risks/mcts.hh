@@ -0,0 +1,738 @@
+#pragma once
+
+#include "actions.hh"
+#include "arena.hh"
+#include "debug.hh"
+#include "fixed_vector.hh"
+#include "rollout_cache.hh"
+#include "root_parallel.hh"
+#include "search_limits.hh"
+#include "thread_pool.hh"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace great_risks
+{
+    template <typename RolloutPolicy, typename State, typename = void>
+    struct has_batch_rollouts : std::false_type
+    {
+    };
+
+    template <typename RolloutPolicy, typename State>
+    struct has_batch_rollouts<
+        RolloutPolicy,
+        State,
+        std::void_t<decltype(std::declval<const RolloutPolicy &>()(
+            std::declval<const State &>(),
+            std::size_t(),
+            unsigned(),
+            std::declval<std::mt19937 &>(),
+            std::declval<float *>()))>>
+      : std::true_type
+    {
+    };
+
+    // Monte Carlo tree search shared by the MCTS agents, specialized at compile time so the
+    // policies inline into the search loop.
+    //
+    // State provides the rules. Nodes don't store it, every worker walks one State down from the
+    // root and back up:
+    //   std::uint64_t key() const          identifies the state, equal states have equal keys
+    //   bool terminal() const
+    //   bool mover_is_red() const          colour of the robot to move
+    //   std::uint8_t mover() const         index of the robot to move
+    //   ActionMask actions() const         legal actions of the robot to move
+    //   void apply(Action a)               a move of the robot to move and whatever follows it
+    //   Undo apply_undoable(Action a)      the same, returning what undo() needs to reverse it
+    //   void undo(const Undo &)            reverses the last apply_undoable() not yet undone
+    //   int score_diff() const             red minus blue score
+    //   float estimated_diff() const       expected final red minus blue score of a nonterminal state
+    //   bool operator==(const State &) const
+    // SelectionPolicy scores all NUM_ACTIONS edge slots of a node in one pass:
+    //   float parent_term(int parent_visits) const, computed once per selection
+    //   void operator()(const float *win_rates, const float *visits, float parent_term,
+    //                   float *scores) const
+    // ExpansionPolicy orders the untried actions of a new node and widens it progressively:
+    //   std::uint8_t operator()(const State &, Action *actions, std::mt19937 &) const writes the
+    //                   legal actions in the order they are expanded and returns their count
+    //   int widening(int visits) const     children a node with that many visits may have
+    // RolloutPolicy picks the actions of a playout, Action operator()(const State &, std::mt19937 &).
+    // If its DETERMINISTIC member is true, every state of a playout that reaches the end is cached
+    // with the result.
+    // It may also play several playouts of at most `horizon` plies from one state together, writing
+    // their final or estimated score differences:
+    //   void operator()(const State &, std::size_t count, unsigned horizon, std::mt19937 &, float *diffs)
+    // RewardFn maps the final score difference, seen from the robot that moved, to a reward in
+    // [0, 1]: float operator()(float own_minus_other) const.
+    //
+    // Action sequences that reach the same state share one node, so the search space is a DAG. A
+    // node's wins and total are shared by all of its parents, each edge counts the visits that
+    // went through it. Nodes and their edges live in arenas and refer to each other by index. A
+    // node holds only its statistics, the action of an edge is stored in the parent's edge slot:
+    // each worker applies the actions of the edges it takes to its own State and undoes them on
+    // the way back up, and only the playouts copy the state they start from. The edges of a node
+    // are stored as arrays with one slot per action (Children), so selection reads them
+    // contiguously and scores them with SIMD instead of visiting every child node; each edge
+    // caches the child's win rate as of its last visit. A node only gets its Children when it is
+    // first expanded, so the leaves, most of the graph, take a 16-byte Node each. Any number of
+    // workers can search the same graph: visits are counted on the way down and rewards added on
+    // the way up, so a path still being rolled out looks like a loss to the others (virtual loss),
+    // and workers claim untried actions with a CAS, so expansion needs no lock. A node only gets
+    // its next child once its visits allow another one, so the budget goes to the actions the
+    // prior ranks first instead of trying every action before UCT runs. The part of the graph
+    // reachable from the next root is kept between calls.
+    //
+    // Besides these workers (tree parallelism), each leaf can be evaluated by several playouts
+    // whose mean reward is backed up (leaf parallelism), see set_leaf_rollouts(). Playouts can be
+    // cut off after a number of plies and the state they reached estimated, see
+    // set_rollout_horizon().
+    template <typename State,
+              typename SelectionPolicy,
+              typename ExpansionPolicy,
+              typename RolloutPolicy,
+              typename RewardFn>
+    class MCTS
+    {
+    private:
+        static constexpr std::uint32_t NO_NODE = std::numeric_limits<std::uint32_t>::max();
+        static constexpr std::uint32_t MAX_NODES = Arena<int>::CAPACITY;
+        // states of a deterministic playout that are cached, longer playouts only cache the first
+        static constexpr std::size_t MAX_CACHED_STATES = 255;
+
+        struct Node
+        {
+            std::atomic<float> wins;
+            std::atomic<int> total;
+            // index of the node's Children, NO_NODE until the worker that claims the first edge
+            // has created them and for terminal nodes
+            std::atomic<std::uint32_t> children;
+            std::uint8_t num_edges;
+            // edges before `claimed` have been taken for expansion
+            std::atomic<std::uint8_t> claimed;
+        };
+        static_assert(sizeof(Node) == 16);
+
+        // one edge taken on the way down, with what is needed to go back up
+        struct Step
+        {
+            typename State::Undo undo;
+            // slot of the edge in the parent's Children
+            std::uint8_t slot;
+            bool mover_is_red;
+        };
+
+        // Outgoing edges of a node in the first num_edges slots. A child's own counters are
+        // shared by all its parents, so the edge keeps a copy of its win rate, refreshed
+        // whenever a visit passes through the edge.
+        struct alignas(32) Children
+        {
+            std::array<std::atomic<float>, NUM_ACTIONS> win_rates;
+            std::array<std::atomic<int>, NUM_ACTIONS> visits;
+            // NO_NODE until the worker expanding the edge publishes the child
+            std::array<std::atomic<std::uint32_t>, NUM_ACTIONS> nodes;
+            std::array<Action, NUM_ACTIONS> actions;
+        };
+
+        struct Graph
+        {
+            Arena<Node> nodes;
+            Arena<Children> children;
+        };
+
+        // node index by state key, with one lock per shard
+        class NodeTable
+        {
+        private:
+            static constexpr std::size_t NUM_SHARDS = 64;
+
+            struct Shard
+            {
+                std::mutex mutex;
+                std::unordered_map<std::uint64_t, std::uint32_t> nodes;
+            };
+
+            std::array<Shard, NUM_SHARDS> shards;
+
+            Shard &shard(std::uint64_t key)
+            {
+                return shards[(key >> 32) % NUM_SHARDS];
+            }
+
+        public:
+            std::uint32_t find(std::uint64_t key)
+            {
+                Shard &s = shard(key);
+                std::lock_guard<std::mutex> lock(s.mutex);
+                auto it = s.nodes.find(key);
+                return it == s.nodes.end() ? NO_NODE : it->second;
+            }
+
+            // stores node unless another worker stored one under the same key first, returns the
+            // node that ends up in the table
+            std::uint32_t insert(std::uint64_t key, std::uint32_t node)
+            {
+                Shard &s = shard(key);
+                std::lock_guard<std::mutex> lock(s.mutex);
+                return s.nodes.try_emplace(key, node).first->second;
+            }
+
+            void clear()
+            {
+                for (Shard &s : shards)
+                {
+                    s.nodes.clear();
+                }
+            }
+
+            // calls f(key, node) for every entry, while no worker runs
+            template <typename F>
+            void for_each(F f) const
+            {
+                for (const Shard &s : shards)
+                {
+                    for (const auto &[key, node] : s.nodes)
+                    {
+                        f(key, node);
+                    }
+                }
+            }
+        };
+
+        SelectionPolicy selection;
+        ExpansionPolicy expansion;
+        RolloutPolicy rollout_policy;
+        RewardFn reward;
+        std::mt19937 rng;
+        // 0 for the size of the global pool, looked up by every search
+        unsigned num_threads;
+        // the graph being searched and the one the next root's part is copied into
+        std::unique_ptr<Graph> graph;
+        std::unique_ptr<Graph> spare;
+        NodeTable transpositions;
+        RolloutCache rollout_cache;
+        std::size_t iterations = 0;
+        unsigned leaf_rollouts = 1;
+        unsigned rollout_horizon = std::numeric_limits<unsigned>::max();
+
+        static void add(std::atomic<float> &value, float delta)
+        {
+            float old = value.load();
+            while (!value.compare_exchange_weak(old, old + delta))
+            {
+            }
+        }
+
+        std::uint32_t new_node(const State &state)
+        {
+            std::uint32_t index = graph->nodes.allocate();
+            Node &node = graph->nodes[index];
+            node.wins = 0;
+            node.total = 0;
+            node.claimed = 0;
+            node.num_edges = state.terminal() ? 0 : count_actions(state.actions());
+            node.children.store(NO_NODE, std::memory_order_relaxed);
+            return index;
+        }
+
+        // node for state, shared with any other path that reached it
+        std::uint32_t find_or_add(const State &state)
+        {
+            std::uint64_t key = state.key();
+            std::uint32_t node = transpositions.find(key);
+            if (node == NO_NODE)
+            {
+                node = transpositions.insert(key, new_node(state));
+            }
+            return node;
+        }
+
+        // Children of a node whose slot k this worker claimed, state being the node's. The worker
+        // claiming slot 0 creates them with the untried actions best first by the prior, the ones
+        // claiming later slots wait until it has published them.
+        Children &claimed_children(Node &node, std::uint8_t k, const State &state, std::mt19937 &rng)
+        {
+            if (k > 0)
+            {
+                std::uint32_t index;
+                while ((index = node.children.load(std::memory_order_acquire)) == NO_NODE)
+                {
+                    std::this_thread::yield();
+                }
+                return graph->children[index];
+            }
+            std::uint32_t index = graph->children.allocate();
+            Children &children = graph->children[index];
+            std::array<Action, NUM_ACTIONS> actions = {};
+            std::uint8_t num_actions = expansion(state, actions.data(), rng);
+            GREAT_RISKS_CHECK(num_actions == node.num_edges);
+            (void)num_actions;
+            for (std::uint8_t slot = 0; slot < NUM_ACTIONS; slot++)
+            {
+                children.win_rates[slot].store(0, std::memory_order_relaxed);
+                children.visits[slot].store(0, std::memory_order_relaxed);
+                children.nodes[slot].store(NO_NODE, std::memory_order_relaxed);
+                children.actions[slot] = actions[slot];
+            }
+            node.children.store(index, std::memory_order_release);
+            return children;
+        }
+
+        // index of an edge this worker may expand, or num_edges if the node's visits don't allow
+        // another child or all are taken
+        std::uint8_t claim(Node &node) const
+        {
+            std::uint8_t next = node.claimed.load();
+            if (next >= node.num_edges)
+            {
+                return node.num_edges;
+            }
+            int limit = std::min<int>(node.num_edges, expansion.widening(node.total.load()));
+            while (next < limit && !node.claimed.compare_exchange_weak(next, next + 1))
+            {
+            }
+            return next < limit ? next : node.num_edges;
+        }
+
+        // copies the child's current win rate into slot k of children
+        static void refresh(Children &children, std::uint8_t k, const Node &child)
+        {
+            children.win_rates[k].store(
+                child.wins.load(std::memory_order_relaxed) / child.total.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+        }
+
+        // state has had the action of slot k applied already
+        std::uint32_t expand(Children &children, std::uint8_t k, const State &state)
+        {
+            std::uint32_t child = find_or_add(state);
+            // the visit of the worker expanding it counts right away, like a virtual loss
+            graph->nodes[child].total++;
+            refresh(children, k, graph->nodes[child]);
+            children.nodes[k].store(child, std::memory_order_relaxed);
+            // a slot counts as published once it has visits, see select()
+            children.visits[k].store(1, std::memory_order_release);
+            return child;
+        }
+
+        // slot of the edge with the best selection score among the published children,
+        // NUM_ACTIONS if there are none yet
+        std::uint8_t select(const Node &node) const
+        {
+            std::uint32_t index = node.children.load(std::memory_order_acquire);
+            if (index == NO_NODE)
+            {
+                return NUM_ACTIONS;
+            }
+            const Children &children = graph->children[index];
+            // plain copies of the counters, slots without visits are unpublished or unused
+            alignas(32) float win_rates[NUM_ACTIONS];
+            alignas(32) float visits[NUM_ACTIONS];
+            alignas(32) float scores[NUM_ACTIONS];
+            for (std::uint8_t k = 0; k < NUM_ACTIONS; k++)
+            {
+                visits[k] = children.visits[k].load(std::memory_order_acquire);
+                win_rates[k] = children.win_rates[k].load(std::memory_order_relaxed);
+            }
+            selection(win_rates, visits, selection.parent_term(node.total.load()), scores);
+#ifdef __AVX2__
+            // first slot with the highest score among those with visits
+            const __m256 none = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+            __m256 low = _mm256_load_ps(scores);
+            __m256 high = _mm256_load_ps(scores + 8);
+            __m256 low_visited = _mm256_cmp_ps(_mm256_load_ps(visits), _mm256_setzero_ps(), _CMP_GT_OQ);
+            __m256 high_visited = _mm256_cmp_ps(_mm256_load_ps(visits + 8), _mm256_setzero_ps(), _CMP_GT_OQ);
+            unsigned visited = _mm256_movemask_ps(low_visited) | _mm256_movemask_ps(high_visited) << 8;
+            if (visited == 0)
+            {
+                return NUM_ACTIONS;
+            }
+            low = _mm256_blendv_ps(none, low, low_visited);
+            high = _mm256_blendv_ps(none, high, high_visited);
+            __m256 best = _mm256_max_ps(low, high);
+            best = _mm256_max_ps(best, _mm256_permute2f128_ps(best, best, 1));
+            best = _mm256_max_ps(best, _mm256_shuffle_ps(best, best, _MM_SHUFFLE(1, 0, 3, 2)));
+            best = _mm256_max_ps(best, _mm256_shuffle_ps(best, best, _MM_SHUFFLE(2, 3, 0, 1)));
+            unsigned is_best = _mm256_movemask_ps(_mm256_cmp_ps(low, best, _CMP_EQ_OQ)) |
+                               _mm256_movemask_ps(_mm256_cmp_ps(high, best, _CMP_EQ_OQ)) << 8;
+            return __builtin_ctz(is_best & visited);
+#else
+            std::uint8_t best = NUM_ACTIONS;
+            for (std::uint8_t k = 0; k < NUM_ACTIONS; k++)
+            {
+                if (visits[k] > 0 && (best == NUM_ACTIONS || scores[k] > scores[best]))
+                {
+                    best = k;
+                }
+            }
+            return best;
+#endif
+        }
+
+        // red minus blue score at the end of a playout, estimated if the horizon cut it off
+        static float final_diff(const State &rollout)
+        {
+            return rollout.terminal() ? rollout.score_diff() : rollout.estimated_diff();
+        }
+
+        // Red minus blue score of a playout from state. The score at the end holds for every state
+        // a deterministic playout passed, but an estimate at the horizon only for the first one:
+        // from a later state it would look less far ahead than the horizon.
+        float simulate(const State &state, std::mt19937 &rng)
+        {
+            float cached;
+            if (rollout_cache.find(state.key(), cached))
+            {
+                return cached;
+            }
+            State rollout = state;
+            FixedVector<std::uint64_t, MAX_CACHED_STATES> keys;
+            keys.push_back(rollout.key());
+            for (unsigned ply = 0; ply < rollout_horizon && !rollout.terminal(); ply++)
+            {
+                rollout.apply(rollout_policy(rollout, rng));
+                if constexpr (RolloutPolicy::DETERMINISTIC)
+                {
+                    if (!keys.full())
+                    {
+                        keys.push_back(rollout.key());
+                    }
+                }
+            }
+            float diff = final_diff(rollout);
+            std::size_t cached_states = rollout.terminal() ? keys.size() : 1;
+            for (std::size_t i = 0; i < cached_states; i++)
+            {
+                rollout_cache.insert(keys[i], diff);
+            }
+            return diff;
+        }
+
+        // mean rewards of red and blue movers over the playouts of one leaf, diffs holds
+        // leaf_rollouts results
+        std::pair<float, float> evaluate(const State &state, std::mt19937 &rng, std::vector<float> &diffs)
+        {
+            if (RolloutPolicy::DETERMINISTIC || leaf_rollouts == 1)
+            {
+                float diff = simulate(state, rng);
+                return {reward(diff), reward(-diff)};
+            }
+            // a single cached playout would stand in for all of them, so these aren't cached
+            if constexpr (has_batch_rollouts<RolloutPolicy, State>::value)
+            {
+                rollout_policy(state, diffs.size(), rollout_horizon, rng, diffs.data());
+            }
+            else
+            {
+                for (float &diff : diffs)
+                {
+                    State rollout = state;
+                    for (unsigned ply = 0; ply < rollout_horizon && !rollout.terminal(); ply++)
+                    {
+                        rollout.apply(rollout_policy(rollout, rng));
+                    }
+                    diff = final_diff(rollout);
+                }
+            }
+            float red_reward = 0;
+            float blue_reward = 0;
+            for (float diff : diffs)
+            {
+                red_reward += reward(diff);
+                blue_reward += reward(-diff);
+            }
+            return {red_reward / diffs.size(), blue_reward / diffs.size()};
+        }
+
+        void run(std::uint32_t root, const State &root_state, const SearchBudget &budget,
+                 std::atomic<std::size_t> &started, std::atomic<std::size_t> &completed, std::uint32_t seed)
+        {
+            std::mt19937 rng(seed);
+            // the worker's state, at the root between iterations
+            State state = root_state;
+            std::vector<std::uint32_t> path;
+            // edge taken into path[i + 1]
+            std::vector<Step> steps;
+            std::vector<float> diffs(leaf_rollouts);
+            // Every worker completes an iteration even if the budget ran out while it was set up,
+            // so the root always has a visited child. Forked workers start late by design.
+            for (bool first = true; graph->nodes.size() < MAX_NODES; first = false)
+            {
+                if (!budget.allows(started++) && !first)
+                {
+                    break;
+                }
+                std::uint32_t node = root;
+                graph->nodes[node].total++;
+                path.assign(1, node);
+                steps.clear();
+                while (!state.terminal())
+                {
+                    // expansion when the node may still get an untried action
+                    Node &current = graph->nodes[node];
+                    std::uint8_t k = claim(current);
+                    bool expanding = k < current.num_edges;
+                    if (!expanding)
+                    {
+                        k = select(current);
+                    }
+                    if (k == NUM_ACTIONS)
+                    {
+                        // the only children are still being built by other workers
+                        break;
+                    }
+                    Children &children = expanding ? claimed_children(current, k, state, rng)
+                                                   : graph->children[current.children.load(std::memory_order_relaxed)];
+                    bool mover_is_red = state.mover_is_red();
+                    steps.push_back({state.apply_undoable(children.actions[k]), k, mover_is_red});
+                    if (expanding)
+                    {
+                        node = expand(children, k, state);
+                        path.push_back(node);
+                        break;
+                    }
+                    children.visits[k]++;
+                    node = children.nodes[k].load(std::memory_order_acquire);
+                    graph->nodes[node].total++;
+                    refresh(children, k, graph->nodes[node]);
+                    path.push_back(node);
+                }
+                auto [red_reward, blue_reward] = evaluate(state, rng, diffs);
+                // backpropagation along the path taken, a node's wins are those of the robot that
+                // moved into it
+                for (std::size_t i = path.size() - 1; i > 0; i--)
+                {
+                    const Step &step = steps[i - 1];
+                    Node &child = graph->nodes[path[i]];
+                    add(child.wins, step.mover_is_red ? red_reward : blue_reward);
+                    refresh(graph->children[graph->nodes[path[i - 1]].children.load(std::memory_order_relaxed)],
+                            step.slot,
+                            child);
+                    state.undo(step.undo);
+                }
+                GREAT_RISKS_CHECK(state == root_state);
+                completed++;
+            }
+        }
+
+        // Makes the node of state the root. If the last search reached it, everything reachable
+        // from it is copied into the spare graph with its statistics and the rest is dropped.
+        std::uint32_t set_root(const State &state)
+        {
+            std::uint32_t old_root = transpositions.find(state.key());
+            spare->nodes.clear();
+            spare->children.clear();
+            if (old_root == NO_NODE)
+            {
+                transpositions.clear();
+                std::swap(graph, spare);
+                return find_or_add(state);
+            }
+            // new indices in breadth-first order
+            std::unordered_map<std::uint32_t, std::uint32_t> moved = {{old_root, 0}};
+            std::vector<std::uint32_t> order = {old_root};
+            for (std::size_t i = 0; i < order.size(); i++)
+            {
+                std::uint32_t children = graph->nodes[order[i]].children.load();
+                if (children == NO_NODE)
+                {
+                    continue;
+                }
+                for (std::uint8_t k = 0; k < graph->nodes[order[i]].num_edges; k++)
+                {
+                    std::uint32_t child = graph->children[children].nodes[k].load();
+                    if (child != NO_NODE && moved.emplace(child, order.size()).second)
+                    {
+                        order.push_back(child);
+                    }
+                }
+            }
+            // nodes don't know their state, so the keys of the kept ones come from the table
+            std::vector<std::pair<std::uint64_t, std::uint32_t>> keys;
+            transpositions.for_each(
+                [&](std::uint64_t key, std::uint32_t node)
+                {
+                    auto it = moved.find(node);
+                    if (it != moved.end())
+                    {
+                        keys.emplace_back(key, it->second);
+                    }
+                });
+            transpositions.clear();
+            for (const auto &[key, node] : keys)
+            {
+                transpositions.insert(key, node);
+            }
+            for (std::uint32_t old_index : order)
+            {
+                const Node &from = graph->nodes[old_index];
+                std::uint32_t index = spare->nodes.allocate();
+                Node &to = spare->nodes[index];
+                to.wins = from.wins.load();
+                to.total = from.total.load();
+                to.claimed = from.claimed.load();
+                to.num_edges = from.num_edges;
+                to.children = NO_NODE;
+                if (from.children.load() != NO_NODE)
+                {
+                    to.children = spare->children.allocate();
+                    const Children &old_children = graph->children[from.children.load()];
+                    Children &children = spare->children[to.children.load()];
+                    for (std::uint8_t k = 0; k < NUM_ACTIONS; k++)
+                    {
+                        std::uint32_t child = old_children.nodes[k].load();
+                        children.win_rates[k] = old_children.win_rates[k].load();
+                        children.visits[k] = old_children.visits[k].load();
+                        children.nodes[k] = child == NO_NODE ? NO_NODE : moved.at(child);
+                        children.actions[k] = old_children.actions[k];
+                    }
+                }
+            }
+            std::swap(graph, spare);
+            GREAT_RISKS_CHECK(transpositions.find(state.key()) == 0);
+            return 0;
+        }
+
+    public:
+        MCTS(SelectionPolicy selection,
+             ExpansionPolicy expansion,
+             RolloutPolicy rollout_policy,
+             RewardFn reward,
+             std::uint32_t seed = 5489,
+             unsigned num_threads = 1)
+          : selection(selection), expansion(expansion), rollout_policy(rollout_policy), reward(reward),
+            rng(seed), num_threads(num_threads), graph(std::make_unique<Graph>()),
+            spare(std::make_unique<Graph>()) {};
+
+        // Searches from state until the limits are reached and returns the action whose child
+        // has the best win rate. Every worker completes at least one iteration. With more than one
+        // thread the workers run on the global pool, num_threads 0 uses all of its threads.
+        Action search(const State &state, const SearchLimits &limits)
+        {
+            return search(state, SearchBudget(limits));
+        }
+
+        // same, with a budget whose clock the caller started
+        Action search(const State &state, const SearchBudget &budget)
+        {
+            std::uint32_t root = set_root(state);
+            std::atomic<std::size_t> started = 0;
+            std::atomic<std::size_t> completed = 0;
+            // resolved here rather than at construction so ThreadPool::configure() still applies
+            unsigned threads = num_threads == 0 ? ThreadPool::global().size() : num_threads;
+            if (threads <= 1)
+            {
+                run(root, state, budget, started, completed, rng());
+            }
+            else
+            {
+                ThreadPool &pool = ThreadPool::global();
+                ThreadPool::TaskGroup searches;
+                for (unsigned i = 0; i < threads; i++)
+                {
+                    std::uint32_t seed = rng();
+                    pool.submit(
+                        searches, [this, root, &state, &budget, &started, &completed, seed]
+                        { run(root, state, budget, started, completed, seed); });
+                }
+                pool.wait(searches);
+            }
+            iterations = completed;
+
+            const Node &node = graph->nodes[root];
+            if (node.children.load() == NO_NODE)
+            {
+                // a terminal root, any legal action will do
+                return first_action(state.actions());
+            }
+            const Children &children = graph->children[node.children.load()];
+            Action selected_action = children.actions[0];
+            float highest_win_rate = -1.0;
+            for (std::uint8_t k = 0; k < node.num_edges; k++)
+            {
+                std::uint32_t child = children.nodes[k].load();
+                if (child == NO_NODE)
+                {
+                    continue;
+                }
+                const Node &child_node = graph->nodes[child];
+                float win_rate = child_node.wins.load() / child_node.total.load();
+                if (win_rate > highest_win_rate)
+                {
+                    highest_win_rate = win_rate;
+                    selected_action = children.actions[k];
+                }
+            }
+            return selected_action;
+        }
+
+        // Playouts per leaf. Only random playouts profit from more than one, deterministic
+        // policies always play one.
+        void set_leaf_rollouts(unsigned count)
+        {
+            leaf_rollouts = std::max(count, 1u);
+        }
+
+        // Replaces the playout cache by an empty one of at most `bytes`.
+        void set_rollout_cache_memory(std::size_t bytes)
+        {
+            rollout_cache = RolloutCache(bytes);
+        }
+
+        RolloutCache::Stats rollout_cache_stats() const
+        {
+            return rollout_cache.stats();
+        }
+
+        // Plies a playout runs before the state it reached is estimated, 0 plays to the end.
+        // Cached results were played to the old horizon, so the playout cache is cleared.
+        void set_rollout_horizon(unsigned plies)
+        {
+            rollout_horizon = plies == 0 ? std::numeric_limits<unsigned>::max() : plies;
+            rollout_cache.clear();
+        }
+
+        // iterations the last search completed
+        std::size_t last_iterations() const
+        {
+            return iterations;
+        }
+
+        // statistics of the last search's root children, set_root() always puts the root first
+        RootStatistics root_statistics() const
+        {
+            RootStatistics statistics;
+            statistics.iterations = iterations;
+            if (graph->nodes.size() == 0 || graph->nodes[0].children.load() == NO_NODE)
+            {
+                return statistics;
+            }
+            const Node &node = graph->nodes[0];
+            const Children &children = graph->children[node.children.load()];
+            for (std::uint8_t k = 0; k < node.num_edges; k++)
+            {
+                std::uint32_t child = children.nodes[k].load();
+                if (child != NO_NODE)
+                {
+                    statistics.wins[children.actions[k]] = graph->nodes[child].wins.load();
+                    statistics.visits[children.actions[k]] = graph->nodes[child].total.load();
+                }
+            }
+            return statistics;
+        }
+    };
+}  // namespace great_risks
@@ -1,173 +1,160 @@
 #include "mcts_agent_greedy.hh"
 
-#include <algorithm>
-#include <thread>
+#include "mcts.hh"
+#include "mcts_policies.hh"
+#include "root_parallel.hh"
 
-constexpr int NUM_ITERATIONS = 10000;
-const float EXPLORATION_PARAM = sqrt(2);
+#include <unistd.h>
+
+#include <mutex>
+#include <type_traits>
+#include <vector>
 
 namespace great_risks
 {
-    class Node
+    using GreedyModel = MemoizedGreedy<GreedyAgent>;
+
+    namespace
     {
-    public:
-        float wins;
-        int total;
-        Field state;
-        Action action;
-        Node *parent;
-        std::vector<Node *> children;
-        std::vector<Action> unexplored_actions;
+        // what a forked worker needs for a move, copied into the workers' shared segment
+        struct ForkedMove
+        {
+            GreedyReplyState<Field, GreedyModel> state;
+            SearchBudget budget;
+        };
+        static_assert(std::is_trivially_copyable_v<ForkedMove>);
+
+        // lookups forked workers served from their own copies of the greedy cache
+        std::mutex forked_greedy_mutex;
+        ActionCache::Stats forked_greedy_stats;
+    }  // namespace
+
+    class MCTSAgentGreedy::Search
+      : public MCTS<GreedyReplyState<Field, GreedyModel>,
+                    UCT,
+                    GreedyPriorWidening<GreedyModel>,
+                    GreedyRollout<GreedyModel>,
+                    ShapedReward>
+    {
+        using MCTS::MCTS;
     };
 
-    void mcts_thread(Node *root, size_t iterations, GreedyAgent &self_greedy, GreedyAgent &opp_greedy, std::mt19937 &rng, tsl::robin_map<Field, float> &rollout_cache, uint8_t index, uint8_t opp_index, std::mutex &mtx) {
-        bool is_red = root->state.robots[index].is_red;
-        Node *nodes = new Node[iterations];
-        for (size_t i = 0; i < iterations; i++)
-        {
-            // selection: stop when node is not fully explored or it is terminal
-            Node *node = root;
-            while (node->unexplored_actions.empty() && node->state.time_remaining > 0)
-            {
-                float best_score = 0.0;
-                Node *best_child = node->children.front();
-                for (size_t i = 0; i < node->children.size(); i++)
-                {
-                    Node *child = node->children[i];
-                    float score = child->wins / child->total +
-                                   EXPLORATION_PARAM * sqrt(log(node->total) / child->total);
-                    if (score > best_score)
-                    {
-                        best_score = score;
-                        best_child = child;
-                    }
-                }
-                node = best_child;
-            }
-            // expansion when non-terminal
-            if (node->state.time_remaining > 0)
-            {
-                Node *child = &nodes[i];
-                child->wins = 0;
-                child->total = 0;
-                // do agent action
-                child->state = node->state;
-                child->action = node->unexplored_actions.back();
-                node->unexplored_actions.pop_back();
-                child->state.perform_action(index, child->action);
-                // do opponent action
-                Action opp_action = opp_greedy.next_action(child->state);
-                child->state.perform_action(opp_index, opp_action);
-                // decrement time
-                child->state.time_remaining--;
-                child->parent = node;
-                node->children.push_back(child);
-                child->unexplored_actions = child->state.legal_actions(index);
-                mtx.lock();
-                std::shuffle(child->unexplored_actions.begin(), child->unexplored_actions.end(), rng);
-                mtx.unlock();
-                node = child;
-            }
-            // rollout
-            Field rollout = node->state;
-            float reward = 0;
-            mtx.lock();
-            auto cached = rollout_cache.find(rollout);
-            bool is_cached = cached != rollout_cache.end();
-            mtx.unlock();
-            if (is_cached)
-            {
-                reward = cached->second;
-            }
-            else
-            {
-                std::vector<Field> rollouts;
-                rollouts.reserve(rollout.time_remaining + 1);
-                rollouts.emplace_back(rollout);
-                while (rollout.time_remaining > 0)
-                {
-                    Action self_action = self_greedy.next_action(rollout);
-                    rollout.perform_action(index, self_action);
-                    Action opp_action = opp_greedy.next_action(rollout);
-                    rollout.perform_action(opp_index, opp_action);
-                    rollout.time_remaining--;
-                    rollouts.emplace_back(rollout);
-                }
-                auto [red_score, blue_score] = rollout.calculate_scores();
-                if (is_red) {
-                    reward = 1 - exp(0.1 * (blue_score - red_score));
-                    if (reward < 0) reward = 0;
-                } else {
-                    reward = 1 - exp(0.1 * (red_score - blue_score));
-                    if (reward < 0) reward = 0;
-                }
-                mtx.lock();
-                for (const auto &rollout : rollouts) {
-                    rollout_cache.insert_or_assign(rollout, reward);
-                }
-                mtx.unlock();
-                //rollout_cache.insert_or_assign(node->state, reward);
-            }
-            // backpropagation
-            while (node != root->parent)
-            {
-                node->total++;
-                node->wins += reward;
-                node = node->parent;
-            }
-        }
-        delete[] nodes;
+    MCTSAgentGreedy::MCTSAgentGreedy(uint8_t index, uint8_t opp_index, uint32_t seed, unsigned num_threads)
+      : Agent(index), opp_index(opp_index),
+        search(std::make_unique<Search>(UCT(),
+                                        GreedyPriorWidening<GreedyModel>(),
+                                        GreedyRollout<GreedyModel>(),
+                                        ShapedReward(),
+                                        seed,
+                                        num_threads)),
+        rng(seed)
+    {
     }
 
-    Action MCTSAgentGreedy::next_action(Field field)
+    MCTSAgentGreedy::~MCTSAgentGreedy() = default;
+
+    Action MCTSAgentGreedy::next_action(const Field &field)
     {
-        Node root;
-        root.wins = 0;
-        root.total = 0;
-        root.state = field;
-        //bool is_red = field.robots[robot_index].is_red;
-        root.parent = nullptr;
-        root.unexplored_actions = field.legal_actions(robot_index);
-        size_t num_threads = root.unexplored_actions.size();
-        std::vector<std::thread> threads;
-        threads.reserve(num_threads);
-        while (!root.unexplored_actions.empty()) {
-            Node *child = new Node();
-            child->wins = 0;
-            child->total = 0;
-            // do agent action
-            child->state = root.state;
-            child->action = root.unexplored_actions.back();
-            root.unexplored_actions.pop_back();
-            child->state.perform_action(robot_index, child->action);
-            // do opponent action
-            Action opp_action = opp_greedy.next_action(child->state);
-            child->state.perform_action(opp_index, opp_action);
-            // decrement time
-            child->state.time_remaining--;
-            child->parent = &root;
-            root.children.push_back(child);
-            child->unexplored_actions = child->state.legal_actions(robot_index);
-            std::shuffle(child->unexplored_actions.begin(), child->unexplored_actions.end(), rng);
-            threads.emplace_back(mcts_thread, child, NUM_ITERATIONS / num_threads, std::ref(self_greedy), std::ref(opp_greedy), std::ref(rng), std::ref(rollout_cache), robot_index, opp_index, std::ref(mtx));
-        }
-        for (auto &thread : threads) {
-            thread.join();
+        // forking and setting up the workers counts against the deadline too
+        ForkedMove move = {{field, robot_index, opp_index}, SearchBudget(limits)};
+        if (num_processes == 1)
+        {
+            Action action = search->search(move.state, move.budget);
+            iterations = search->last_iterations();
+            return action;
         }
-        Action selected_action = root.children[0]->action;
-        double highest_win_rate = 0.0;
-        for (const Node *const&child : root.children)
+        if (!workers)
         {
-            double win_rate = child->wins / child->total;
-            if (win_rate > highest_win_rate)
+            // each process only ever touches its own entry
+            auto searches = std::make_shared<std::vector<std::unique_ptr<Search>>>(num_processes);
+            // cache counters each worker had reported up to its last job
+            auto reported = std::make_shared<std::vector<WorkerCacheStats>>(num_processes);
+            std::vector<uint32_t> seeds(num_processes);
+            for (uint32_t &seed : seeds)
             {
-                highest_win_rate = win_rate;
-                selected_action = child->action;
+                seed = rng();
             }
+            workers = std::make_unique<RootParallelWorkers>(
+                num_processes,
+                sizeof(ForkedMove),
+                [this, searches, reported, seeds, owner = getpid()](
+                    unsigned worker, const void *job, WorkerCacheStats &cache_stats)
+                {
+                    std::unique_ptr<Search> &worker_search = (*searches)[worker];
+                    WorkerCacheStats &worker_reported = (*reported)[worker];
+                    if (!worker_search)
+                    {
+                        // the copy of the greedy cache arrives with the counts of the fork
+                        worker_reported.greedy = GreedyModel::cache().stats();
+                        worker_search = std::make_unique<Search>(UCT(),
+                                                                 GreedyPriorWidening<GreedyModel>(),
+                                                                 GreedyRollout<GreedyModel>(),
+                                                                 ShapedReward(),
+                                                                 seeds[worker]);
+                        worker_search->set_rollout_horizon(rollout_horizon);
+                        // the agent's budget is shared out between the workers
+                        worker_search->set_rollout_cache_memory(rollout_cache_memory / num_processes);
+                    }
+                    const ForkedMove &move = *static_cast<const ForkedMove *>(job);
+                    worker_search->search(move.state, move.budget);
+                    WorkerCacheStats current = {worker_search->rollout_cache_stats(),
+                                                GreedyModel::cache().stats()};
+                    cache_stats.rollouts = current.rollouts - worker_reported.rollouts;
+                    // a worker running in the caller looks up the caller's greedy cache
+                    if (getpid() != owner)
+                    {
+                        cache_stats.greedy = current.greedy - worker_reported.greedy;
+                    }
+                    worker_reported = current;
+                    return worker_search->root_statistics();
+                });
         }
-        for (auto &child : root.children) {
-            delete child;
+        RootStatistics statistics = workers->run(&move);
+        iterations = statistics.iterations;
+        forked_rollout_stats += workers->cache_stats().rollouts;
+        {
+            std::lock_guard<std::mutex> lock(forked_greedy_mutex);
+            forked_greedy_stats += workers->cache_stats().greedy;
         }
-        return selected_action;
+        // only when every worker died
+        return statistics.best_action(GreedyModel(robot_index).next_action(field));
+    }
+
+    void MCTSAgentGreedy::set_processes(unsigned count)
+    {
+        num_processes = std::max(count, 1u);
+        workers.reset();
+    }
+
+    void MCTSAgentGreedy::set_rollout_horizon(unsigned ticks)
+    {
+        rollout_horizon = ticks;
+        workers.reset();
+        search->set_rollout_horizon(ticks);
+    }
+
+    ActionCache::Stats MCTSAgentGreedy::greedy_cache_stats()
+    {
+        ActionCache::Stats stats = GreedyModel::cache().stats();
+        std::lock_guard<std::mutex> lock(forked_greedy_mutex);
+        return stats += forked_greedy_stats;
+    }
+
+    void MCTSAgentGreedy::set_rollout_cache_memory(std::size_t bytes)
+    {
+        rollout_cache_memory = bytes;
+        workers.reset();
+        search->set_rollout_cache_memory(bytes);
+    }
+
+    RolloutCache::Stats MCTSAgentGreedy::rollout_cache_stats() const
+    {
+        RolloutCache::Stats stats = search->rollout_cache_stats();
+        return stats += forked_rollout_stats;
+    }
+
+    std::size_t MCTSAgentGreedy::last_iterations() const
+    {
+        return iterations;
     }
-}  // namespace great_risks
\ No newline at end of file
+}  // namespace great_risks
@@ -1,32 +1,79 @@
 #pragma once
 
 #include "greedy_agent.hh"
+#include "rollout_cache.hh"
+#include "root_parallel.hh"
+#include "search_limits.hh"
 
-#include <mutex>
+#include <algorithm>
+#include <cstddef>
+#include <memory>
 #include <random>
-#include <unordered_map>
-#include <tsl/robin_map.h>
 
 namespace great_risks
 {
+    // MCTS where the opponent answers every action with its greedy agent and playouts are greedy
+    // on both sides
     class MCTSAgentGreedy : public Agent
     {
     private:
-        GreedyAgent self_greedy;
-        GreedyAgent opp_greedy;
+        class Search;
+
         uint8_t opp_index;
+        SearchLimits limits;
+        // searches run in parallel on the global thread pool and keep their graph between calls
+        std::unique_ptr<Search> search;
+        // forked by the first call with more than one process, dropped when a setting changes
+        std::unique_ptr<RootParallelWorkers> workers;
+        // seeds of the forked searches
         std::mt19937 rng;
-        tsl::robin_map<Field, float> rollout_cache;
-        std::mutex mtx;
+        unsigned num_processes = 1;
+        unsigned rollout_horizon = 0;
+        std::size_t rollout_cache_memory = RolloutCache::DEFAULT_MEMORY;
+        // lookups the rollout caches of the forked searches served
+        RolloutCache::Stats forked_rollout_stats;
+        std::size_t iterations = 0;
 
     public:
-        MCTSAgentGreedy(uint8_t index, uint8_t opp_index, uint32_t seed = 5489)
-          : Agent(index), self_greedy(index), opp_greedy(opp_index), opp_index(opp_index)
+        // num_threads workers search the same graph on the global thread pool, 0 for as many as
+        // it has when the search runs
+        MCTSAgentGreedy(
+            uint8_t index,
+            uint8_t opp_index,
+            uint32_t seed = 5489,
+            unsigned num_threads = 0);
+        ~MCTSAgentGreedy() override;
+
+        Action next_action(const Field &field) override;
+
+        void set_limits(const SearchLimits &new_limits)
         {
-            rng.seed(seed);
+            limits = new_limits;
         }
-        ~MCTSAgentGreedy() override = default;
 
-        Action next_action(Field field) override;
+        // With more than one process, that many independent single-threaded searches run in
+        // forked workers and their root statistics are merged (root parallelism) instead of
+        // searching one graph on the thread pool. The workers are forked by the next call and
+        // keep their graphs and caches across calls. That call also pays for the fork (about
+        // 25 ms), and every worker completes at least one iteration even past the deadline.
+        // After that a move costs about 0.4 ms on top of the search for the round trip through
+        // the workers, so budgets below a few ms per move are better searched in one process.
+        void set_processes(unsigned count);
+
+        // Ticks a playout runs before its state is estimated, 0 plays to the end.
+        void set_rollout_horizon(unsigned ticks);
+
+        // Lookups of the greedy decisions memoized for all searches of the full field, which
+        // includes the prior of MCTSAgentRandom. Counts add up over the whole process and the
+        // workers it forked.
+        static ActionCache::Stats greedy_cache_stats();
+
+        // memory the cache of playout results may take, dropping what it holds
+        void set_rollout_cache_memory(std::size_t bytes);
+        // summed over this agent's searches, forked ones included
+        RolloutCache::Stats rollout_cache_stats() const;
+
+        // iterations the last call completed, summed over all processes
+        std::size_t last_iterations() const;
     };
-}  // namespace great_risks
\ No newline at end of file
+}  // namespace great_risks
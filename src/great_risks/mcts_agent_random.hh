@@ -1,21 +1,47 @@
 #pragma once
 
 #include "agent.hh"
+#include "rollout_cache.hh"
+#include "search_limits.hh"
 
-#include <random>
-#include <tsl/robin_map.h>
+#include <cstddef>
+#include <memory>
 
 namespace great_risks
 {
+    // MCTS over the turns of every robot, with weighted random playouts
     class MCTSAgentRandom : public Agent
     {
     private:
-        std::mt19937 rng;
-        std::array<std::unordered_map<Field, int>, 2> rollout_cache;
+        class Search;
+
+        SearchLimits limits;
+        std::unique_ptr<Search> search;
 
     public:
-        MCTSAgentRandom(uint8_t index, uint32_t seed = 5489) : Agent(index), rng(seed) {};
-        ~MCTSAgentRandom() override = default;
-        Action next_action(Field field) override;
+        // num_threads workers search the same graph on the global thread pool
+        MCTSAgentRandom(uint8_t index, uint32_t seed = 5489, unsigned num_threads = 1);
+        ~MCTSAgentRandom() override;
+
+        Action next_action(const Field &field) override;
+
+        void set_limits(const SearchLimits &new_limits)
+        {
+            limits = new_limits;
+        }
+
+        // Random playouts run per leaf, their mean reward is backed up. They are stepped
+        // together with the SIMD kernels of FieldBatch.
+        void set_leaf_rollouts(unsigned count);
+
+        // Robot turns a playout runs before its state is estimated, 0 plays to the end.
+        void set_rollout_horizon(unsigned plies);
+
+        // memory the cache of playout results may take, dropping what it holds
+        void set_rollout_cache_memory(std::size_t bytes);
+        RolloutCache::Stats rollout_cache_stats() const;
+
+        // iterations the last call completed
+        std::size_t last_iterations() const;
     };
-}  // namespace great_risks
\ No newline at end of file
+}  // namespace great_risks
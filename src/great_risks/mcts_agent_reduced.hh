@@ -1,28 +1,33 @@
 #pragma once
 
 #include "reduced_game.hh"
-#include "greedy_agent_reduced.hh"
+#include "search_limits.hh"
 
-#include <random>
-#include <unordered_map>
+#include <memory>
 
 namespace great_risks
 {
     class MCTSAgentReduced : public ReducedAgent
     {
     private:
-        GreedyAgentReduced greedy;
+        class Search;
+
         uint8_t opp_index;
-        std::mt19937 rng;
-        std::unordered_map<ReducedField, double> rollout_cache;
+        SearchLimits limits;
+        std::unique_ptr<Search> search;
 
     public:
-        MCTSAgentReduced(uint8_t index, uint8_t opp_index, uint32_t seed = 5489)
-          : ReducedAgent(index), greedy(opp_index), opp_index(opp_index)
+        MCTSAgentReduced(uint8_t index, uint8_t opp_index, uint32_t seed = 5489);
+        ~MCTSAgentReduced();
+
+        Action next_action(const ReducedField &field) override;
+
+        void set_limits(const SearchLimits &new_limits)
         {
-            rng.seed(seed);
-        };
+            limits = new_limits;
+        }
 
-        Action next_action(ReducedField field) override;
+        // iterations the last call completed
+        std::size_t last_iterations() const;
     };
-}  // namespace great_risks
\ No newline at end of file
+}  // namespace great_risks
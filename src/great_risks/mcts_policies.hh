@@ -0,0 +1,348 @@
+#pragma once
+
+#include "actions.hh"
+#include "evaluation.hh"
+#include "rollout_cache.hh"
+#include "simulator.hh"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include <pthread.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace great_risks
+{
+    // scoring actions and picking up the robot's own colour
+    template <typename F>
+    ActionMask preferred_actions(const F &field, std::uint8_t i)
+    {
+        return action_bit(GRAB_MOBILE_GOAL) | action_bit(SCORE_MOBILE_GOAL) | action_bit(SCORE_WALL_STAKE) |
+               action_bit(field.robots[i].is_red ? PICK_UP_RED : PICK_UP_BLUE);
+    }
+
+    // A greedy agent whose decisions are memoized by field key and robot. Greedy only depends on
+    // the field, so one bounded cache per agent type serves every search, thread and match at
+    // once. The key covers the time, so the entries of earlier moves age out on their own. The
+    // worker processes of RootParallelWorkers keep using it, so fork() waits until no thread holds
+    // a shard.
+    template <typename Greedy>
+    class MemoizedGreedy
+    {
+    private:
+        std::uint8_t index;
+
+    public:
+        static constexpr std::size_t CACHE_MEMORY = std::size_t(16) << 20;
+
+        explicit MemoizedGreedy(std::uint8_t index) : index(index) {};
+
+        static ActionCache &cache()
+        {
+            static ActionCache actions(CACHE_MEMORY);
+            static const int fork_handlers = pthread_atfork([] { actions.lock_shards(); },
+                                                            [] { actions.unlock_shards(); },
+                                                            [] { actions.unlock_shards(); });
+            (void)fork_handlers;
+            return actions;
+        }
+
+        template <typename F>
+        Action next_action(const F &field) const
+        {
+            std::uint64_t key = field.key ^ ((index + 1) * 0x9e3779b97f4a7c15ull);
+            Action action;
+            if (!cache().find(key, action))
+            {
+                action = Greedy(index).next_action(field);
+                cache().insert(key, action);
+            }
+            return action;
+        }
+    };
+
+    // Our robot moves, the opponent answers with its greedy agent, then time advances. Every state
+    // has our robot to move, so the field's key identifies it.
+    template <typename F, typename Opponent>
+    struct GreedyReplyState
+    {
+        F field;
+        std::uint8_t self = 0;
+        std::uint8_t opponent = 0;
+
+        std::uint64_t key() const
+        {
+            return field.key;
+        }
+
+        bool terminal() const
+        {
+            return field.time_remaining <= 0;
+        }
+
+        bool mover_is_red() const
+        {
+            return field.robots[self].is_red;
+        }
+
+        std::uint8_t mover() const
+        {
+            return self;
+        }
+
+        ActionMask actions() const
+        {
+            return field.legal_action_mask(self);
+        }
+
+        // both robots' actions, undone in reverse order
+        struct Undo
+        {
+            UndoRecord own;
+            UndoRecord reply;
+        };
+
+        void apply(Action a)
+        {
+            field.perform_action(self, a);
+            field.perform_action(opponent, Opponent(opponent).next_action(field));
+            field.tick();
+        }
+
+        Undo apply_undoable(Action a)
+        {
+            Undo record;
+            record.own = field.perform_action_undoable(self, a);
+            record.reply = field.perform_action_undoable(opponent, Opponent(opponent).next_action(field));
+            field.tick();
+            return record;
+        }
+
+        void undo(const Undo &record)
+        {
+            field.untick();
+            field.undo_action(opponent, record.reply);
+            field.undo_action(self, record.own);
+        }
+
+        int score_diff() const
+        {
+            auto [red_score, blue_score] = field.calculate_scores();
+            return red_score - blue_score;
+        }
+
+        float estimated_diff() const
+        {
+            return estimate_score_diff(field);
+        }
+
+        bool operator==(const GreedyReplyState &other) const
+        {
+            return field == other.field && self == other.self && opponent == other.opponent;
+        }
+    };
+
+    // Every robot picks its own actions in turn, time advances after the last one.
+    struct TurnState
+    {
+        Field field;
+        std::uint8_t player = 0;
+
+        // the Zobrist key doesn't cover whose turn it is, so that is mixed in
+        std::uint64_t key() const
+        {
+            return field.key ^ ((player + 1) * 0x9e3779b97f4a7c15ull);
+        }
+
+        bool terminal() const
+        {
+            return field.time_remaining <= 0;
+        }
+
+        bool mover_is_red() const
+        {
+            return field.robots[player].is_red;
+        }
+
+        std::uint8_t mover() const
+        {
+            return player;
+        }
+
+        ActionMask actions() const
+        {
+            return field.legal_action_mask(player);
+        }
+
+        using Undo = UndoRecord;
+
+        void apply(Action a)
+        {
+            field.perform_action(player, a);
+            player = (player + 1) % field.robots.size();
+            if (player == 0)
+            {
+                field.tick();
+            }
+        }
+
+        Undo apply_undoable(Action a)
+        {
+            Undo record = field.perform_action_undoable(player, a);
+            player = (player + 1) % field.robots.size();
+            if (player == 0)
+            {
+                field.tick();
+            }
+            return record;
+        }
+
+        void undo(const Undo &record)
+        {
+            if (player == 0)
+            {
+                field.untick();
+            }
+            player = (player + field.robots.size() - 1) % field.robots.size();
+            field.undo_action(player, record);
+        }
+
+        int score_diff() const
+        {
+            auto [red_score, blue_score] = field.calculate_scores();
+            return red_score - blue_score;
+        }
+
+        float estimated_diff() const
+        {
+            return estimate_score_diff(field);
+        }
+
+        bool operator==(const TurnState &other) const
+        {
+            return field == other.field && player == other.player;
+        }
+    };
+
+    // log(n) for the visit counts most nodes have
+    inline const std::array<float, 4096> LOG_TABLE = []
+    {
+        std::array<float, 4096> table = {};
+        for (std::size_t n = 1; n < table.size(); n++)
+        {
+            table[n] = log(n);
+        }
+        return table;
+    }();
+
+    // UCB1 with the visits of the edge, so every parent of a shared node explores on its own
+    struct UCT
+    {
+        float exploration = 1.41421;
+
+        float parent_term(int parent_visits) const
+        {
+            return static_cast<std::size_t>(parent_visits) < LOG_TABLE.size() ? LOG_TABLE[parent_visits]
+                                                                                : log(parent_visits);
+        }
+
+        // win rate + exploration * sqrt(log(parent visits) / edge visits) for NUM_ACTIONS slots,
+        // the arrays are 32-byte aligned; scores of slots without visits are ignored
+        void operator()(const float *win_rates, const float *visits, float parent_term, float *scores) const
+        {
+#ifdef __AVX2__
+            static_assert(NUM_ACTIONS % 8 == 0);
+            const __m256 c = _mm256_set1_ps(exploration);
+            const __m256 parent = _mm256_set1_ps(parent_term);
+            for (std::size_t k = 0; k < NUM_ACTIONS; k += 8)
+            {
+                __m256 explore = _mm256_sqrt_ps(_mm256_div_ps(parent, _mm256_load_ps(visits + k)));
+                _mm256_store_ps(scores + k, _mm256_add_ps(_mm256_load_ps(win_rates + k), _mm256_mul_ps(c, explore)));
+            }
+#else
+            for (std::size_t k = 0; k < NUM_ACTIONS; k++)
+            {
+                scores[k] = win_rates[k] + exploration * std::sqrt(parent_term / visits[k]);
+            }
+#endif
+        }
+    };
+
+    // Progressive widening ordered by a prior: the greedy agent's action first, then the actions
+    // the random playouts prefer, then moves, then the rest, with RELEASE_RING, TIP_MOBILE_GOAL
+    // and DO_NOTHING last. Ties are broken randomly. A node with n visits may have
+    // ceil(coefficient * n^exponent) children.
+    template <typename Greedy>
+    struct GreedyPriorWidening
+    {
+        float coefficient = 1;
+        float exponent = 0.5;
+
+        template <typename S>
+        std::uint8_t operator()(const S &state, Action *actions, std::mt19937 &rng) const
+        {
+            constexpr ActionMask RARELY_USEFUL =
+                action_bit(RELEASE_RING) | action_bit(TIP_MOBILE_GOAL) | action_bit(DO_NOTHING);
+            ActionMask remaining = state.actions();
+            const std::array<ActionMask, 5> tiers = {
+                action_bit(Greedy(state.mover()).next_action(state.field)),
+                preferred_actions(state.field, state.mover()),
+                MOVE_ACTIONS,
+                static_cast<ActionMask>(~RARELY_USEFUL),
+                RARELY_USEFUL};
+            std::uint8_t n = 0;
+            for (ActionMask tier : tiers)
+            {
+                std::uint8_t begin = n;
+                for (Action a : ActionRange(remaining & tier))
+                {
+                    actions[n++] = a;
+                }
+                remaining &= ~tier;
+                std::shuffle(actions + begin, actions + n, rng);
+            }
+            return n;
+        }
+
+        int widening(int visits) const
+        {
+            return std::ceil(coefficient * std::pow(visits, exponent));
+        }
+    };
+
+    // playouts where our robot follows its greedy agent too
+    template <typename Greedy>
+    struct GreedyRollout
+    {
+        static constexpr bool DETERMINISTIC = true;
+
+        template <typename S>
+        Action operator()(const S &state, std::mt19937 &) const
+        {
+            return Greedy(state.self).next_action(state.field);
+        }
+    };
+
+    // 1 - e^(-0.1 diff), so a large lead counts little more than a solid one, losses count 0
+    struct ShapedReward
+    {
+        float operator()(float diff) const
+        {
+            float reward = 1 - exp(-0.1 * diff);
+            return reward < 0 ? 0 : reward;
+        }
+    };
+
+    struct WinLossReward
+    {
+        float operator()(float diff) const
+        {
+            return diff > 0 ? 1 : diff == 0 ? 0.5 : 0;
+        }
+    };
+}  // namespace great_risks
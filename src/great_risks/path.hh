@@ -0,0 +1,93 @@
+#pragma once
+
+#include "bitboard.hh"
+
+#include <array>
+#include <cstdint>
+
+namespace great_risks
+{
+    // Outcome of a shortest path search towards a set of target cells. x, y is the target that was
+    // reached; a search that starts on a target has distance 0 and first_move DO_NOTHING. When no
+    // target can be reached, found is false and x, y is the start cell.
+    struct PathResult
+    {
+        bool found;
+        Action first_move;
+        std::uint8_t x;
+        std::uint8_t y;
+        std::uint8_t distance;
+    };
+
+    constexpr unsigned NO_CELL = 255;
+
+    // Breadth-first search over the free cells of a WxW board without allocating: every cell is
+    // queued at most once, so a flat array is enough for the queue, and the cell each one was
+    // reached from goes into `parent`. Neighbours are expanded north, south, east, west, so ties
+    // between equally near targets go to the same target as before. Returns the target reached
+    // or NO_CELL.
+    template <std::uint8_t W>
+    unsigned bfs(CellMask free, unsigned start, CellMask targets, std::array<std::uint8_t, W * W> &parent)
+    {
+        if (has_cell(targets, start))
+        {
+            return start;
+        }
+        std::array<std::uint8_t, W * W> queue;
+        unsigned head = 0;
+        unsigned tail = 0;
+        queue[tail++] = start;
+        CellMask unexplored = free & ~cell_bit(start);
+        while (head < tail)
+        {
+            unsigned cell = queue[head++];
+            for (Action move : ActionRange(neighbour_moves<W>(unexplored, cell / W, cell % W)))
+            {
+                unsigned next = neighbour_cell<W>(cell, move);
+                parent[next] = cell;
+                // the first target queued is also the first one a search popping targets would find
+                if (has_cell(targets, next))
+                {
+                    return next;
+                }
+                unexplored &= ~cell_bit(next);
+                queue[tail++] = next;
+            }
+        }
+        return NO_CELL;
+    }
+
+    // direction of a single step between two neighbouring cells
+    template <std::uint8_t W>
+    Action step_direction(unsigned from, unsigned to)
+    {
+        return to + W == from ? MOVE_NORTH : to == from + W ? MOVE_SOUTH : to == from + 1 ? MOVE_EAST : MOVE_WEST;
+    }
+
+    template <std::uint8_t W>
+    PathResult shortest_path(CellMask free, unsigned x, unsigned y, CellMask targets)
+    {
+        std::array<std::uint8_t, W * W> parent;
+        unsigned start = x * W + y;
+        unsigned target = bfs<W>(free, start, targets, parent);
+        if (target == NO_CELL)
+        {
+            return {false, DO_NOTHING, static_cast<std::uint8_t>(x), static_cast<std::uint8_t>(y), 0};
+        }
+        std::uint8_t distance = 0;
+        unsigned cell = target;
+        unsigned first = target;
+        while (cell != start)
+        {
+            first = cell;
+            cell = parent[cell];
+            distance++;
+        }
+        Action first_move = distance == 0 ? DO_NOTHING : step_direction<W>(start, first);
+        return {true,
+                first_move,
+                static_cast<std::uint8_t>(target / W),
+                static_cast<std::uint8_t>(target % W),
+                distance};
+    }
+}  // namespace great_risks
@@ -4,9 +4,9 @@
 
 namespace great_risks
 {
-    Action RandomAgent::next_action(Field Field)
+    Action RandomAgent::next_action(const Field &field)
     {
-        auto actions = Field.legal_actions(robot_index);
-        return actions[rand() % actions.size()];
+        ActionMask actions = field.legal_action_mask(robot_index);
+        return pick_nth(actions, rand() % count_actions(actions));
     }
 }  // namespace great_risks
\ No newline at end of file
@@ -9,6 +9,6 @@ namespace great_risks
         using Agent::Agent;
 
     public:
-        Action next_action(Field field) override;
+        Action next_action(const Field &field) override;
     };
 }  // namespace great_risks
\ No newline at end of file
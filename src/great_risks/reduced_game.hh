@@ -4,36 +4,42 @@
 
 namespace great_risks
 {
-    class ReducedField
+    // 5x5 variant with three goals, two robots and no autonomous period or endgame rules
+    struct ReducedGeometry
     {
-    public:
-        std::array<MobileGoal, 3> goals;
-        std::array<WallStake, 2> stakes;
-        std::array<std::array<uint8_t, 5>, 5> red_rings = {};
-        std::array<std::array<uint8_t, 5>, 5> blue_rings = {};
-        std::array<Robot, 2> robots;
-        uint8_t time_remaining = 30;
-        ReducedField();
-        std::vector<Action> legal_actions(uint8_t i);
-        void perform_action(uint8_t i, Action a);
-        std::array<int, 2> calculate_scores();
-        std::pair<std::array<uint8_t, 2>, std::vector<Action>> shortest_path(
-            std::array<uint8_t, 2> begin,
-            std::unordered_set<std::array<uint8_t, 2>> targets,
-            bool is_red);
-
-        bool operator==(const ReducedField &other) const
-        {
-            return (
-                time_remaining == other.time_remaining &&
-                std::equal(goals.begin(), goals.end(), other.goals.begin()) &&
-                std::equal(stakes.begin(), stakes.end(), other.stakes.begin()) &&
-                std::equal(robots.begin(), robots.end(), other.robots.begin()) &&
-                std::equal(red_rings.begin(), red_rings.end(), other.red_rings.begin()) &&
-                std::equal(blue_rings.begin(), blue_rings.end(), other.blue_rings.begin()));
-        }
+        static constexpr std::uint8_t WIDTH = 5;
+        static constexpr std::size_t MAX_ROBOTS = 2;
+        static constexpr std::uint8_t START_TIME = 30;
+        static constexpr std::uint8_t AUTONOMOUS_END = START_TIME;
+        static constexpr int PROTECTED_CORNER_TIME = -1;
+        static constexpr bool CAN_DO_NOTHING = false;
+        static constexpr std::array<std::array<std::uint8_t, 2>, 3> GOALS = {{{1, 2}, {2, 2}, {3, 2}}};
+        static constexpr std::array<std::array<std::uint8_t, 2>, 2> STAKES = {{{0, 2}, {4, 2}}};
+        static constexpr std::array<std::array<std::uint8_t, 2>, 0> POSTS = {};
+        static constexpr std::array<std::array<std::uint8_t, 2>, 2> NEGATIVE_CORNERS = {{{0, 0}, {0, 4}}};
+        static constexpr std::array<std::array<std::uint8_t, 2>, 2> POSITIVE_CORNERS = {{{4, 0}, {4, 4}}};
+        static constexpr std::array<RingPile, 12> RINGS = {{
+            {0, 0, 2, 2},
+            {0, 2, 1, 1},
+            {0, 4, 2, 2},
+            {1, 1, 1, 1},
+            {1, 3, 1, 1},
+            {2, 1, 1, 1},
+            {2, 3, 1, 1},
+            {3, 1, 1, 1},
+            {3, 3, 1, 1},
+            {4, 0, 2, 2},
+            {4, 2, 1, 1},
+            {4, 4, 2, 2},
+        }};
+        static constexpr std::array<Robot, 2> ROBOTS = {{{2, 0, NO_GOAL, {}, true}, {2, 4, NO_GOAL, {}, false}}};
     };
 
+    using ReducedField = BasicField<ReducedGeometry>;
+    extern template class BasicField<ReducedGeometry>;
+
+    static_assert(std::is_trivially_copyable_v<ReducedField>);
+
     class ReducedAgent
     {
     protected:
@@ -41,32 +47,16 @@ namespace great_risks
 
     public:
         ReducedAgent(std::uint8_t robot_index) : robot_index(robot_index) {};
-        virtual Action next_action(ReducedField field) = 0;
-    };
-}  // namespace great_risks
+        virtual Action next_action(const ReducedField &field) = 0;
 
-template <>
-struct std::hash<great_risks::ReducedField>
-{
-    size_t operator()(const great_risks::ReducedField &field) const noexcept
-    {
-        size_t seed = 0;
-        hash<great_risks::MobileGoal> goal_hash;
-        for (auto &goal : field.goals)
-        {
-            seed ^= goal_hash(goal) + (seed << 6) + (seed >> 2);
-        }
-        hash<great_risks::WallStake> stake_hash;
-        for (auto &stake : field.stakes)
+        // actions[i] = next_action(fields[i]) for count fields, agents can override it to decide
+        // for all of them at once
+        virtual void next_actions(const ReducedField *fields, std::size_t count, Action *actions)
         {
-            seed ^= stake_hash(stake) + (seed << 6) + (seed >> 2);
+            for (std::size_t i = 0; i < count; i++)
+            {
+                actions[i] = next_action(fields[i]);
+            }
         }
-        hash<great_risks::Robot> robot_hash;
-        for (auto &robot : field.robots)
-        {
-            seed ^= robot_hash(robot) + (seed << 6) + (seed >> 2);
-        }
-        seed = field.time_remaining + (seed << 6) + (seed >> 2);
-        return seed;
-    }
-};
\ No newline at end of file
+    };
+}  // namespace great_risks
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+namespace great_risks
+{
+    enum Ring
+    {
+        RED,
+        BLUE
+    };
+
+    // Fixed-capacity stack of rings stored inline as a count plus one color bit per ring
+    // (bit i set means ring i is blue). Index 0 is the bottom of the stack, i.e. the ring
+    // that leaves a robot first when it scores.
+    template <std::size_t N>
+    class RingStack
+    {
+        static_assert(N <= 8, "ring colors must fit in a single byte");
+
+    private:
+        std::uint8_t count = 0;
+        std::uint8_t colors = 0;
+
+    public:
+        // inverse of code()
+        static RingStack from_code(std::uint8_t code)
+        {
+            RingStack stack;
+            stack.count = static_cast<std::uint8_t>(31 - __builtin_clz(code));
+            stack.colors = static_cast<std::uint8_t>(code & ~(1u << stack.count));
+            return stack;
+        }
+
+        class const_iterator
+        {
+        private:
+            const RingStack *stack;
+            std::uint8_t index;
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Ring;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = Ring;
+
+            const_iterator(const RingStack *stack, std::uint8_t index) : stack(stack), index(index) {};
+
+            Ring operator*() const
+            {
+                return (*stack)[index];
+            }
+
+            const_iterator &operator++()
+            {
+                index++;
+                return *this;
+            }
+
+            const_iterator operator++(int)
+            {
+                const_iterator old = *this;
+                index++;
+                return old;
+            }
+
+            bool operator==(const const_iterator &other) const
+            {
+                return index == other.index;
+            }
+
+            bool operator!=(const const_iterator &other) const
+            {
+                return index != other.index;
+            }
+        };
+
+        static constexpr std::size_t capacity()
+        {
+            return N;
+        }
+
+        std::size_t size() const
+        {
+            return count;
+        }
+
+        bool empty() const
+        {
+            return count == 0;
+        }
+
+        bool full() const
+        {
+            return count == N;
+        }
+
+        // color bits of the rings currently on the stack, bits above size() are always zero
+        std::uint8_t color_bits() const
+        {
+            return colors;
+        }
+
+        // small integer that is unique for every possible stack content, always below 2^(N+1)
+        std::uint8_t code() const
+        {
+            return static_cast<std::uint8_t>((1u << count) | colors);
+        }
+
+        Ring operator[](std::size_t i) const
+        {
+            return static_cast<Ring>((colors >> i) & 1);
+        }
+
+        Ring front() const
+        {
+            return static_cast<Ring>(colors & 1);
+        }
+
+        Ring back() const
+        {
+            return static_cast<Ring>((colors >> (count - 1)) & 1);
+        }
+
+        void push_back(Ring ring)
+        {
+            colors |= static_cast<std::uint8_t>(ring << count);
+            count++;
+        }
+
+        void pop_back()
+        {
+            count--;
+            colors &= static_cast<std::uint8_t>(~(1u << count));
+        }
+
+        void push_front(Ring ring)
+        {
+            colors = static_cast<std::uint8_t>((colors << 1) | ring);
+            count++;
+        }
+
+        void pop_front()
+        {
+            colors >>= 1;
+            count--;
+        }
+
+        void clear()
+        {
+            count = 0;
+            colors = 0;
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(this, 0);
+        }
+
+        const_iterator end() const
+        {
+            return const_iterator(this, count);
+        }
+
+        bool operator==(const RingStack &other) const
+        {
+            return count == other.count && colors == other.colors;
+        }
+
+        bool operator!=(const RingStack &other) const
+        {
+            return !(*this == other);
+        }
+    };
+}  // namespace great_risks
@@ -0,0 +1,141 @@
+#include "rollout_cache.hh"
+
+#include <algorithm>
+#include <new>
+
+namespace great_risks
+{
+    template <typename V>
+    BasicStateCache<V>::BasicStateCache(std::size_t memory, unsigned num_shards)
+    {
+        std::size_t shard_count = 1;
+        while (shard_count < num_shards)
+        {
+            shard_count *= 2;
+        }
+        // buckets per shard, rounded down to a power of two
+        std::size_t buckets = std::max<std::size_t>(memory / shard_count / sizeof(Bucket), 1);
+        while (buckets & (buckets - 1))
+        {
+            buckets &= buckets - 1;
+        }
+        for (std::size_t i = 0; i < shard_count; i++)
+        {
+            shards.push_back(std::make_unique<Shard>());
+            shards.back()->buckets.reset(static_cast<Bucket *>(std::calloc(buckets, sizeof(Bucket))));
+            if (!shards.back()->buckets)
+            {
+                throw std::bad_alloc();
+            }
+            shards.back()->num_buckets = buckets;
+        }
+    }
+
+    template <typename V>
+    bool BasicStateCache<V>::find(std::uint64_t key, V &value)
+    {
+        Shard &s = shard(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        Bucket &bucket = s.buckets[key & (s.num_buckets - 1)];
+        for (std::size_t way = 0; way < WAYS; way++)
+        {
+            if ((bucket.used >> way & 1) && bucket.keys[way] == key)
+            {
+                bucket.referenced |= 1 << way;
+                value = bucket.values[way];
+                s.stats.hits++;
+                return true;
+            }
+        }
+        s.stats.misses++;
+        return false;
+    }
+
+    template <typename V>
+    void BasicStateCache<V>::insert(std::uint64_t key, V value)
+    {
+        Shard &s = shard(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        Bucket &bucket = s.buckets[key & (s.num_buckets - 1)];
+        for (std::size_t way = 0; way < WAYS; way++)
+        {
+            if ((bucket.used >> way & 1) && bucket.keys[way] == key)
+            {
+                bucket.values[way] = value;
+                return;
+            }
+        }
+        std::size_t way;
+        if (bucket.used != 0xff)
+        {
+            way = __builtin_ctz(~bucket.used);
+        }
+        else
+        {
+            // clock: clear reference bits until the hand finds an entry that was not read
+            while (bucket.referenced >> bucket.hand & 1)
+            {
+                bucket.referenced &= ~(1 << bucket.hand);
+                bucket.hand = (bucket.hand + 1) % WAYS;
+            }
+            way = bucket.hand;
+            bucket.hand = (bucket.hand + 1) % WAYS;
+            s.stats.evictions++;
+        }
+        bucket.used |= 1 << way;
+        bucket.referenced &= ~(1 << way);
+        bucket.keys[way] = key;
+        bucket.values[way] = value;
+    }
+
+    template <typename V>
+    typename BasicStateCache<V>::Stats BasicStateCache<V>::stats() const
+    {
+        Stats total;
+        for (const auto &s : shards)
+        {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            total.hits += s->stats.hits;
+            total.misses += s->stats.misses;
+            total.evictions += s->stats.evictions;
+        }
+        return total;
+    }
+
+    template <typename V>
+    void BasicStateCache<V>::clear()
+    {
+        for (auto &s : shards)
+        {
+            // fresh zeroed buckets rather than a memset, so the pages are given back until used
+            Bucket *buckets = static_cast<Bucket *>(std::calloc(s->num_buckets, sizeof(Bucket)));
+            if (!buckets)
+            {
+                throw std::bad_alloc();
+            }
+            std::lock_guard<std::mutex> lock(s->mutex);
+            s->buckets.reset(buckets);
+        }
+    }
+
+    template <typename V>
+    void BasicStateCache<V>::lock_shards()
+    {
+        for (auto &s : shards)
+        {
+            s->mutex.lock();
+        }
+    }
+
+    template <typename V>
+    void BasicStateCache<V>::unlock_shards()
+    {
+        for (auto &s : shards)
+        {
+            s->mutex.unlock();
+        }
+    }
+
+    template class BasicStateCache<float>;
+    template class BasicStateCache<Action>;
+}  // namespace great_risks
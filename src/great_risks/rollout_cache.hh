@@ -0,0 +1,106 @@
+#pragma once
+
+#include "actions.hh"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace great_risks
+{
+    // Values keyed by 64-bit state hashes, with a fixed memory budget. Keys are split
+    // over shards with a lock each, so threads only contend when they touch the same shard. Each
+    // shard is a set-associative table: a key can only live in one bucket of WAYS slots. A full
+    // bucket evicts with the clock algorithm, so entries read since the hand last passed get a
+    // second chance. Only the hash is stored, so two states with the same key share a result.
+    // Buckets come zeroed from calloc, so memory is only backed by pages as buckets get used and
+    // a large budget costs nothing up front.
+    template <typename V>
+    class BasicStateCache
+    {
+    public:
+        static constexpr std::size_t WAYS = 8;
+        static constexpr std::size_t DEFAULT_MEMORY = std::size_t(64) << 20;
+
+        struct Stats
+        {
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            std::uint64_t evictions = 0;
+
+            Stats &operator+=(const Stats &other)
+            {
+                hits += other.hits;
+                misses += other.misses;
+                evictions += other.evictions;
+                return *this;
+            }
+
+            Stats operator-(const Stats &other) const
+            {
+                return {hits - other.hits, misses - other.misses, evictions - other.evictions};
+            }
+        };
+
+    private:
+        // all zero bytes is an empty bucket
+        struct Bucket
+        {
+            std::array<std::uint64_t, WAYS> keys;
+            std::array<V, WAYS> values;
+            std::uint8_t used;
+            std::uint8_t referenced;
+            std::uint8_t hand;
+        };
+
+        struct FreeBuckets
+        {
+            void operator()(Bucket *buckets) const
+            {
+                std::free(buckets);
+            }
+        };
+
+        struct Shard
+        {
+            std::mutex mutex;
+            std::unique_ptr<Bucket[], FreeBuckets> buckets;
+            // a power of two
+            std::size_t num_buckets;
+            Stats stats;
+        };
+
+        std::vector<std::unique_ptr<Shard>> shards;
+
+        // shards use the high half of the key and buckets the low half, so they stay independent
+        Shard &shard(std::uint64_t key)
+        {
+            return *shards[(key >> 32) & (shards.size() - 1)];
+        }
+
+    public:
+        // memory is split evenly over the shards, num_shards is rounded up to a power of two
+        explicit BasicStateCache(std::size_t memory = DEFAULT_MEMORY, unsigned num_shards = 64);
+
+        bool find(std::uint64_t key, V &value);
+        void insert(std::uint64_t key, V value);
+        Stats stats() const;
+        // drops every entry and keeps the memory budget and the counters
+        void clear();
+
+        // Takes and releases every shard's lock, in the pthread_atfork handlers of a cache shared
+        // across fork(), so no shard is left locked by a thread the child doesn't have.
+        void lock_shards();
+        void unlock_shards();
+    };
+
+    // results of playouts
+    using RolloutCache = BasicStateCache<float>;
+    // decisions of deterministic agents
+    using ActionCache = BasicStateCache<Action>;
+    extern template class BasicStateCache<float>;
+    extern template class BasicStateCache<Action>;
+}  // namespace great_risks
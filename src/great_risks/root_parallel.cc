@@ -0,0 +1,256 @@
+#include "root_parallel.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <string>
+
+#include <fcntl.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace great_risks
+{
+    namespace
+    {
+        // one per worker in the shared segment, the caller posts start and the worker done
+        struct Slot
+        {
+            RootStatistics stats;
+            WorkerCacheStats cache_stats;
+            sem_t start;
+            sem_t done;
+        };
+
+        std::atomic<unsigned> next_segment = 0;
+
+        // maps a fresh segment and unlinks its name right away, so it goes away with the last
+        // mapping even if a process crashes
+        void *map_segment(std::size_t size)
+        {
+            std::string name = "/great_risks." + std::to_string(getpid()) + "." + std::to_string(next_segment++);
+            int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd < 0)
+            {
+                return nullptr;
+            }
+            shm_unlink(name.c_str());
+            void *memory = MAP_FAILED;
+            if (ftruncate(fd, size) == 0)
+            {
+                memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            }
+            close(fd);
+            return memory == MAP_FAILED ? nullptr : memory;
+        }
+
+        // Waits until sem is posted. Gives up and returns false when gone() becomes true,
+        // which is checked every `poll` milliseconds.
+        template <typename Gone>
+        bool wait_posted(sem_t &sem, long poll, Gone gone)
+        {
+            while (true)
+            {
+                timespec timeout;
+                clock_gettime(CLOCK_REALTIME, &timeout);
+                timeout.tv_nsec += poll * 1000000;
+                timeout.tv_sec += timeout.tv_nsec / 1000000000;
+                timeout.tv_nsec %= 1000000000;
+                if (sem_timedwait(&sem, &timeout) == 0)
+                {
+                    return true;
+                }
+                if (errno == ETIMEDOUT && gone())
+                {
+                    return false;
+                }
+            }
+        }
+    }  // namespace
+
+    // header of the shared segment, followed by a Slot per worker and the job
+    struct alignas(64) RootParallelWorkers::Segment
+    {
+        std::atomic<int> stopping;
+        pid_t owner;
+
+        Slot &slot(unsigned i)
+        {
+            return reinterpret_cast<Slot *>(this + 1)[i];
+        }
+
+        static std::size_t job_offset(unsigned num_processes)
+        {
+            std::size_t end = sizeof(Segment) + num_processes * sizeof(Slot);
+            return (end + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+        }
+    };
+
+    void RootStatistics::merge(const RootStatistics &other)
+    {
+        for (std::size_t a = 0; a < NUM_ACTIONS; a++)
+        {
+            wins[a] += other.wins[a];
+            visits[a] += other.visits[a];
+        }
+        iterations += other.iterations;
+    }
+
+    Action RootStatistics::best_action(Action fallback) const
+    {
+        Action selected_action = fallback;
+        float highest_win_rate = -1.0;
+        for (Action a : ACTION_ORDER)
+        {
+            if (visits[a] > 0 && wins[a] / visits[a] > highest_win_rate)
+            {
+                highest_win_rate = wins[a] / visits[a];
+                selected_action = a;
+            }
+        }
+        return selected_action;
+    }
+
+    void WorkerCacheStats::merge(const WorkerCacheStats &other)
+    {
+        rollouts += other.rollouts;
+        greedy += other.greedy;
+    }
+
+    RootParallelWorkers::RootParallelWorkers(unsigned num_processes, std::size_t job_size, Search search)
+      : num_processes(std::max(num_processes, 1u)), job_size(job_size), search(std::move(search))
+    {
+    }
+
+    RootParallelWorkers::~RootParallelWorkers()
+    {
+        if (segment == nullptr)
+        {
+            return;
+        }
+        segment->stopping.store(1, std::memory_order_release);
+        for (unsigned i = 0; i < num_processes; i++)
+        {
+            if (workers[i] > 0)
+            {
+                sem_post(&segment->slot(i).start);
+            }
+        }
+        for (pid_t pid : workers)
+        {
+            while (pid > 0 && waitpid(pid, nullptr, 0) < 0 && errno == EINTR)
+            {
+            }
+        }
+        for (unsigned i = 0; i < num_processes; i++)
+        {
+            sem_destroy(&segment->slot(i).start);
+            sem_destroy(&segment->slot(i).done);
+        }
+        munmap(segment, segment_size);
+    }
+
+    void RootParallelWorkers::start()
+    {
+        started = true;
+        if (num_processes == 1)
+        {
+            return;
+        }
+        segment_size = Segment::job_offset(num_processes) + job_size;
+        void *memory = map_segment(segment_size);
+        if (memory == nullptr)
+        {
+            return;
+        }
+        segment = new (memory) Segment();
+        segment->stopping = 0;
+        segment->owner = getpid();
+        for (unsigned i = 0; i < num_processes; i++)
+        {
+            Slot *slot = new (&segment->slot(i)) Slot();
+            sem_init(&slot->start, 1, 0);
+            sem_init(&slot->done, 1, 0);
+        }
+        for (unsigned i = 0; i < num_processes; i++)
+        {
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                serve(i);
+            }
+            workers.push_back(std::max(pid, 0));
+        }
+    }
+
+    void RootParallelWorkers::serve(unsigned worker)
+    {
+        Slot &slot = segment->slot(worker);
+        const void *job = reinterpret_cast<const unsigned char *>(segment) + Segment::job_offset(num_processes);
+        pid_t owner = segment->owner;
+        // a worker whose owner died is adopted by another process
+        while (wait_posted(slot.start, 100, [owner] { return getppid() != owner; }) &&
+               !segment->stopping.load(std::memory_order_acquire))
+        {
+            slot.stats = search(worker, job, slot.cache_stats);
+            sem_post(&slot.done);
+        }
+        // skips the destructors and atexit handlers of the owner's copy
+        _exit(0);
+    }
+
+    RootStatistics RootParallelWorkers::run(const void *job)
+    {
+        if (!started)
+        {
+            start();
+        }
+        last_cache_stats = {};
+        if (segment == nullptr)
+        {
+            return search(0, job, last_cache_stats);
+        }
+        std::memcpy(reinterpret_cast<unsigned char *>(segment) + Segment::job_offset(num_processes), job, job_size);
+        for (unsigned i = 0; i < num_processes; i++)
+        {
+            if (workers[i] > 0)
+            {
+                sem_post(&segment->slot(i).start);
+            }
+        }
+        RootStatistics merged;
+        for (unsigned i = 0; i < num_processes; i++)
+        {
+            if (workers[i] == 0)
+            {
+                WorkerCacheStats cache_stats;
+                merged.merge(search(i, job, cache_stats));
+                last_cache_stats.merge(cache_stats);
+            }
+        }
+        for (unsigned i = 0; i < num_processes; i++)
+        {
+            pid_t pid = workers[i];
+            if (pid <= 0)
+            {
+                continue;
+            }
+            if (wait_posted(segment->slot(i).done, 50, [pid] { return waitpid(pid, nullptr, WNOHANG) == pid; }))
+            {
+                merged.merge(segment->slot(i).stats);
+                last_cache_stats.merge(segment->slot(i).cache_stats);
+            }
+            else
+            {
+                workers[i] = -1;
+            }
+        }
+        return merged;
+    }
+}  // namespace great_risks
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "actions.hh"
+#include "rollout_cache.hh"
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace great_risks
+{
+    // Statistics of the root's children after a search, indexed by action. wins are those of the
+    // robot to move at the root.
+    struct RootStatistics
+    {
+        std::array<float, NUM_ACTIONS> wins = {};
+        std::array<int, NUM_ACTIONS> visits = {};
+        std::size_t iterations = 0;
+
+        void merge(const RootStatistics &other);
+
+        // action with the best win rate among the visited ones, fallback if there are none
+        Action best_action(Action fallback) const;
+    };
+
+    // Lookups a worker's caches served during one job. The caller's copies of the caches never
+    // see what happens in a forked worker, so workers report it.
+    struct WorkerCacheStats
+    {
+        RolloutCache::Stats rollouts;
+        ActionCache::Stats greedy;
+
+        void merge(const WorkerCacheStats &other);
+    };
+
+    // Root parallelism across processes: num_processes workers each run search(worker, job,
+    // cache_stats) on their own copy of the caller's memory, and the statistics and cache counters
+    // they publish in a POSIX shared memory segment are summed. Workers share nothing else, so no
+    // locks or allocators are contended, but they also can't use the thread pool, whose threads
+    // don't exist after a fork.
+    //
+    // The workers are forked by the first run() and then wait for the next job, so whatever
+    // search keeps between calls (its graph, its caches) stays warm and a move only costs a
+    // round trip through the segment. A job is job_size bytes copied into the segment, so it has
+    // to be trivially copyable. Workers exit with the object or with the process that made it. A
+    // worker that can't be forked runs in the caller instead, one that dies is left out.
+    class RootParallelWorkers
+    {
+    public:
+        using Search =
+            std::function<RootStatistics(unsigned worker, const void *job, WorkerCacheStats &cache_stats)>;
+
+    private:
+        struct Segment;
+
+        unsigned num_processes;
+        std::size_t job_size;
+        Search search;
+        bool started = false;
+        Segment *segment = nullptr;
+        std::size_t segment_size = 0;
+        // 0 for workers running in the caller, -1 for dead ones
+        std::vector<pid_t> workers;
+        WorkerCacheStats last_cache_stats;
+
+        void start();
+        [[noreturn]] void serve(unsigned worker);
+
+    public:
+        RootParallelWorkers(unsigned num_processes, std::size_t job_size, Search search);
+        ~RootParallelWorkers();
+
+        RootParallelWorkers(const RootParallelWorkers &) = delete;
+        RootParallelWorkers &operator=(const RootParallelWorkers &) = delete;
+
+        RootStatistics run(const void *job);
+
+        // cache counters of the last run, summed over the workers that finished it
+        const WorkerCacheStats &cache_stats() const
+        {
+            return last_cache_stats;
+        }
+    };
+}  // namespace great_risks
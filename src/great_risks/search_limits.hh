@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace great_risks
+{
+    // When an MCTS agent stops searching for a move: after `iterations` iterations or once `time`
+    // has passed, whichever comes first. An iteration adds at most one node, so the iteration count
+    // is also the node budget of a call. A zero time means no deadline.
+    struct SearchLimits
+    {
+        std::size_t iterations = 10000;
+        std::chrono::nanoseconds time = std::chrono::nanoseconds::zero();
+    };
+
+    // the limits of one call, the clock starts when it is constructed
+    class SearchBudget
+    {
+    private:
+        SearchLimits limits;
+        std::chrono::steady_clock::time_point deadline;
+
+    public:
+        explicit SearchBudget(const SearchLimits &limits)
+          : limits(limits), deadline(std::chrono::steady_clock::now() + limits.time) {};
+
+        // whether another iteration may start after `done` were started
+        bool allows(std::size_t done) const
+        {
+            return done < limits.iterations &&
+                   (limits.time == std::chrono::nanoseconds::zero() || std::chrono::steady_clock::now() < deadline);
+        }
+    };
+}  // namespace great_risks
@@ -1,127 +1,51 @@
 #include "simulator.hh"
 
-#include <deque>
+#include "debug.hh"
+#include "reduced_game.hh"
+
+#include <algorithm>
 
 namespace great_risks
 {
-    Field::Field()
+    template <typename G>
+    BasicField<G>::BasicField()
     {
-        goals[0].x = 1;
-        goals[0].y = 5;
-        goals[1].x = 5;
-        goals[1].y = 1;
-        goals[2].x = 5;
-        goals[2].y = 5;
-        goals[3].x = 5;
-        goals[3].y = 9;
-        goals[4].x = 9;
-        goals[4].y = 5;
-
-        stakes[0].x = 0;
-        stakes[0].y = 5;
-        stakes[1].x = 10;
-        stakes[1].y = 5;
-
-        red_rings[0][0] = 2;
-        red_rings[0][5] = 1;
-        red_rings[0][10] = 2;
-        red_rings[1][1] = 1;
-        red_rings[1][3] = 1;
-        red_rings[1][7] = 1;
-        red_rings[1][9] = 1;
-        red_rings[3][7] = 1;
-        red_rings[5][0] = 1;
-        red_rings[5][10] = 1;
-        red_rings[7][7] = 1;
-        red_rings[9][1] = 1;
-        red_rings[9][3] = 1;
-        red_rings[9][7] = 1;
-        red_rings[9][9] = 1;
-        red_rings[10][0] = 2;
-        red_rings[10][5] = 1;
-        red_rings[10][10] = 2;
-
-        blue_rings[0][0] = 2;
-        blue_rings[0][5] = 1;
-        blue_rings[0][10] = 2;
-        blue_rings[1][1] = 1;
-        blue_rings[1][3] = 1;
-        blue_rings[1][7] = 1;
-        blue_rings[1][9] = 1;
-        blue_rings[3][3] = 1;
-        blue_rings[5][0] = 1;
-        blue_rings[5][10] = 1;
-        blue_rings[7][3] = 1;
-        blue_rings[9][1] = 1;
-        blue_rings[9][3] = 1;
-        blue_rings[9][7] = 1;
-        blue_rings[9][9] = 1;
-        blue_rings[10][0] = 2;
-        blue_rings[10][5] = 1;
-        blue_rings[10][10] = 2;
-    }
-
-    void Field::add_robot(Robot robot)
-    {
-        robots.emplace_back(robot);
-    }
-
-    bool legal_move(int x, int y, bool is_red, const Field &field)
-    {
-        if (x < 0 || x > 10)
-        {
-            return false;
-        }
-        if (y < 0 || y > 10)
-        {
-            return false;
-        }
-        if (field.time_remaining > 90)
-        {
-            if (is_red && y > 5)
-            {
-                return false;
-            }
-            if (!is_red && y < 5)
-            {
-                return false;
-            }
-        }
-        if (x == 3 && y == 5)
+        for (std::size_t i = 0; i < goals.size(); i++)
         {
-            return false;
+            goals[i].x = G::GOALS[i][0];
+            goals[i].y = G::GOALS[i][1];
         }
-        if (x == 5 && y == 3)
+        for (std::size_t i = 0; i < stakes.size(); i++)
         {
-            return false;
+            stakes[i].x = G::STAKES[i][0];
+            stakes[i].y = G::STAKES[i][1];
         }
-        if (x == 5 && y == 7)
+        for (const RingPile &pile : G::RINGS)
         {
-            return false;
+            red_rings[pile.x][pile.y] = pile.red;
+            blue_rings[pile.x][pile.y] = pile.blue;
         }
-        if (x == 7 && y == 5)
+        key = zobrist_key(*this);
+        raw_scores = recalculate_raw_scores();
+        for (const Robot &robot : G::ROBOTS)
         {
-            return false;
+            add_robot(robot);
         }
-        for (const Robot &robot : field.robots)
-        {
-            if (x == robot.x && y == robot.y)
-            {
-                return false;
-            }
-        }
-        return true;
     }
 
-    bool in_protected_corner(int x, int y, int time_remaining)
+    template <typename G>
+    void BasicField<G>::add_robot(Robot robot)
     {
-        return time_remaining <= 15 && x == 10 && (y == 0 || y == 10);
+        robots.push_back(robot);
+        key ^= zobrist_robot(*this, robots.size() - 1);
+        occupancy |= cell_bit(robot.x * WIDTH + robot.y);
     }
 
-    std::uint8_t can_interact_with_goal(int x, int y, const Field &field)
+    template <typename G>
+    std::uint8_t can_interact_with_goal(int x, int y, const BasicField<G> &field)
     {
         // cannot interact with positive corners during endgame
-        if (in_protected_corner(x, y, field.time_remaining))
+        if (field.in_protected_corner(x, y, field.time_remaining))
         {
             return NO_GOAL;
         }
@@ -135,90 +59,94 @@ namespace great_risks
         return NO_GOAL;
     }
 
-    std::vector<Action> Field::legal_actions(std::uint8_t i) const
+    template <typename G>
+    ActionMask BasicField<G>::legal_moves(std::uint8_t i) const
     {
-        Robot robot = robots[i];
-        std::vector<Action> result;
-        if (legal_move(robot.x - 1, robot.y, robot.is_red, *this))
-        {
-            result.push_back(MOVE_NORTH);
-        }
-        if (legal_move(robot.x + 1, robot.y, robot.is_red, *this))
-        {
-            result.push_back(MOVE_SOUTH);
-        }
-        if (legal_move(robot.x, robot.y + 1, robot.is_red, *this))
-        {
-            result.push_back(MOVE_EAST);
-        }
-        if (legal_move(robot.x, robot.y - 1, robot.is_red, *this))
-        {
-            result.push_back(MOVE_WEST);
-        }
+        const Robot &robot = robots[i];
+        return neighbour_moves<WIDTH>(free_cells(robot.is_red), robot.x, robot.y);
+    }
+
+    template <typename G>
+    ActionMask BasicField<G>::legal_action_mask(std::uint8_t i) const
+    {
+        const Robot &robot = robots[i];
+        ActionMask result = legal_moves(i);
         std::uint8_t goal = can_interact_with_goal(robot.x, robot.y, *this);
         if (robot.goal == NO_GOAL && goal != NO_GOAL)
         {
             if (goals[goal].tipped)
             {
-                result.push_back(UNTIP_MOBILE_GOAL);
+                result |= action_bit(UNTIP_MOBILE_GOAL);
             }
             else
             {
-                result.push_back(GRAB_MOBILE_GOAL);
-                result.push_back(TIP_MOBILE_GOAL);
+                result |= action_bit(GRAB_MOBILE_GOAL);
+                result |= action_bit(TIP_MOBILE_GOAL);
             }
         }
         else if (robot.goal != NO_GOAL)
         {
             if (goal == NO_GOAL && !in_protected_corner(robot.x, robot.y, time_remaining))
             {
-                result.push_back(RELEASE_MOBILE_GOAL);
+                result |= action_bit(RELEASE_MOBILE_GOAL);
             }
-            if (!robot.rings.empty() && goals[robot.goal].rings.size() < 6)
+            if (!robot.rings.empty() && !goals[robot.goal].rings.full())
             {
-                result.push_back(SCORE_MOBILE_GOAL);
+                result |= action_bit(SCORE_MOBILE_GOAL);
             }
-            if (!goals[robot.goal].rings.empty() && robot.rings.size() < 2)
+            if (!goals[robot.goal].rings.empty() && !robot.rings.full())
             {
-                result.push_back(DESCORE_MOBILE_GOAL);
+                result |= action_bit(DESCORE_MOBILE_GOAL);
             }
         }
-        if (robot.rings.size() < 2)
+        if (!robot.rings.full())
         {
             if (red_rings[robot.x][robot.y])
             {
-                result.push_back(PICK_UP_RED);
+                result |= action_bit(PICK_UP_RED);
             }
             if (blue_rings[robot.x][robot.y])
             {
-                result.push_back(PICK_UP_BLUE);
+                result |= action_bit(PICK_UP_BLUE);
             }
         }
         if (!robot.rings.empty())
         {
-            result.push_back(RELEASE_RING);
+            result |= action_bit(RELEASE_RING);
         }
         for (const WallStake &stake : stakes)
         {
             if (robot.x == stake.x && robot.y == stake.y)
             {
-                if (!robot.rings.empty() && stake.rings.size() < 6)
+                if (!robot.rings.empty() && !stake.rings.full())
                 {
-                    result.push_back(SCORE_WALL_STAKE);
+                    result |= action_bit(SCORE_WALL_STAKE);
                 }
-                if (!stake.rings.empty() && robot.rings.size() < 2)
+                if (!stake.rings.empty() && !robot.rings.full())
                 {
-                    result.push_back(DESCORE_WALL_STAKE);
+                    result |= action_bit(DESCORE_WALL_STAKE);
                 }
             }
         }
-        result.push_back(DO_NOTHING);
+        if constexpr (G::CAN_DO_NOTHING)
+        {
+            result |= action_bit(DO_NOTHING);
+        }
         return result;
     }
 
-    void Field::perform_action(std::uint8_t i, Action a)
+    template <typename G>
+    std::vector<Action> BasicField<G>::legal_actions(std::uint8_t i) const
+    {
+        return action_list(legal_action_mask(i));
+    }
+
+    template <typename G>
+    void BasicField<G>::perform_action(std::uint8_t i, Action a)
     {
         Robot &robot = robots[i];
+        key ^= zobrist_robot(*this, i);
+        occupancy &= ~cell_bit(robot.x * WIDTH + robot.y);
         switch (a)
         {
             case MOVE_NORTH:
@@ -238,15 +166,19 @@ namespace great_risks
                 {
                     if (goals[i].x == robot.x && goals[i].y == robot.y)
                     {
+                        detach_goal(i);
                         robot.goal = i;
                         goals[i].x = ON_ROBOT;
                         goals[i].y = ON_ROBOT;
+                        attach_goal(i);
                     }
                 }
                 break;
             case RELEASE_MOBILE_GOAL:
+                detach_goal(robot.goal);
                 goals[robot.goal].x = robot.x;
                 goals[robot.goal].y = robot.y;
+                attach_goal(robot.goal);
                 robot.goal = ON_ROBOT;
                 break;
             case TIP_MOBILE_GOAL:
@@ -254,7 +186,9 @@ namespace great_risks
                 {
                     if (goals[i].x == robot.x && goals[i].y == robot.y)
                     {
+                        detach_goal(i);
                         goals[i].tipped = true;
+                        attach_goal(i);
                     }
                 }
                 break;
@@ -263,19 +197,26 @@ namespace great_risks
                 {
                     if (goals[i].x == robot.x && goals[i].y == robot.y)
                     {
+                        detach_goal(i);
                         goals[i].tipped = false;
+                        attach_goal(i);
                     }
                 }
                 break;
             case PICK_UP_RED:
+                key ^= zobrist_loose_rings(*this, robot.x, robot.y);
                 red_rings[robot.x][robot.y]--;
+                key ^= zobrist_loose_rings(*this, robot.x, robot.y);
                 robot.rings.push_back(RED);
                 break;
             case PICK_UP_BLUE:
+                key ^= zobrist_loose_rings(*this, robot.x, robot.y);
                 blue_rings[robot.x][robot.y]--;
+                key ^= zobrist_loose_rings(*this, robot.x, robot.y);
                 robot.rings.push_back(BLUE);
                 break;
             case RELEASE_RING:
+                key ^= zobrist_loose_rings(*this, robot.x, robot.y);
                 if (robot.rings.back() == RED)
                 {
                     red_rings[robot.x][robot.y]++;
@@ -284,40 +225,205 @@ namespace great_risks
                 {
                     blue_rings[robot.x][robot.y]++;
                 }
+                key ^= zobrist_loose_rings(*this, robot.x, robot.y);
                 robot.rings.pop_back();
                 break;
             case SCORE_MOBILE_GOAL:
+                detach_goal(robot.goal);
                 goals[robot.goal].rings.push_back(robot.rings.front());
-                robot.rings.erase(robot.rings.begin());
+                attach_goal(robot.goal);
+                robot.rings.pop_front();
                 break;
             case SCORE_WALL_STAKE:
-                for (WallStake &stake : stakes)
+                for (size_t i = 0; i < stakes.size(); i++)
                 {
-                    if (stake.x == robot.x && stake.y == robot.y)
+                    if (stakes[i].x == robot.x && stakes[i].y == robot.y)
                     {
-                        stake.rings.push_back(robot.rings.front());
-                        robot.rings.erase(robot.rings.begin());
+                        detach_stake(i);
+                        stakes[i].rings.push_back(robot.rings.front());
+                        attach_stake(i);
+                        robot.rings.pop_front();
                     }
                 }
                 break;
             case DESCORE_MOBILE_GOAL:
-                robot.rings.insert(robot.rings.begin(), goals[robot.goal].rings.back());
+                detach_goal(robot.goal);
+                robot.rings.push_front(goals[robot.goal].rings.back());
                 goals[robot.goal].rings.pop_back();
+                attach_goal(robot.goal);
+                break;
+            case DESCORE_WALL_STAKE:
+                for (size_t i = 0; i < stakes.size(); i++)
+                {
+                    if (stakes[i].x == robot.x && stakes[i].y == robot.y)
+                    {
+                        detach_stake(i);
+                        robot.rings.push_front(stakes[i].rings.back());
+                        stakes[i].rings.pop_back();
+                        attach_stake(i);
+                    }
+                }
+                break;
+            case DO_NOTHING:
+                break;
+        }
+        key ^= zobrist_robot(*this, i);
+        occupancy |= cell_bit(robot.x * WIDTH + robot.y);
+        GREAT_RISKS_CHECK(key == zobrist_key(*this));
+        GREAT_RISKS_CHECK(occupancy == robot_cells(*this));
+        GREAT_RISKS_CHECK(raw_scores == recalculate_raw_scores());
+    }
+
+    template <typename G>
+    UndoRecord BasicField<G>::perform_action_undoable(std::uint8_t i, Action a)
+    {
+        const Robot &robot = robots[i];
+        UndoRecord record;
+        record.action = a;
+        record.robot = robot;
+        record.key = key;
+        record.raw_scores = raw_scores;
+        switch (a)
+        {
+            case GRAB_MOBILE_GOAL:
+            case TIP_MOBILE_GOAL:
+            case UNTIP_MOBILE_GOAL:
+                for (size_t i = 0; i < goals.size(); i++)
+                {
+                    if (goals[i].x == robot.x && goals[i].y == robot.y)
+                    {
+                        record.goal = i;
+                    }
+                }
+                break;
+            case RELEASE_MOBILE_GOAL:
+            case SCORE_MOBILE_GOAL:
+            case DESCORE_MOBILE_GOAL:
+                record.goal = robot.goal;
                 break;
+            case SCORE_WALL_STAKE:
             case DESCORE_WALL_STAKE:
-                for (WallStake &stake : stakes)
+                for (size_t i = 0; i < stakes.size(); i++)
                 {
-                    if (stake.x == robot.x && stake.y == robot.y)
+                    if (stakes[i].x == robot.x && stakes[i].y == robot.y)
                     {
-                        robot.rings.insert(robot.rings.begin(), stake.rings.back());
-                        stake.rings.pop_back();
+                        record.stake = i;
+                        record.stake_rings = stakes[i].rings;
                     }
                 }
                 break;
+            default:
+                break;
+        }
+        if (record.goal != NO_GOAL)
+        {
+            record.goal_state = goals[record.goal];
+        }
+        perform_action(i, a);
+        return record;
+    }
+
+    template <typename G>
+    void BasicField<G>::undo_action(std::uint8_t i, const UndoRecord &record)
+    {
+        // loose rings are the only state not saved in the record, the robot has not moved since
+        const Robot &robot = record.robot;
+        switch (record.action)
+        {
+            case PICK_UP_RED:
+                red_rings[robot.x][robot.y]++;
+                break;
+            case PICK_UP_BLUE:
+                blue_rings[robot.x][robot.y]++;
+                break;
+            case RELEASE_RING:
+                if (robot.rings.back() == RED)
+                {
+                    red_rings[robot.x][robot.y]--;
+                }
+                else
+                {
+                    blue_rings[robot.x][robot.y]--;
+                }
+                break;
+            default:
+                break;
+        }
+        occupancy &= ~cell_bit(robots[i].x * WIDTH + robots[i].y);
+        robots[i] = robot;
+        occupancy |= cell_bit(robot.x * WIDTH + robot.y);
+        if (record.goal != NO_GOAL)
+        {
+            goals[record.goal] = record.goal_state;
+        }
+        if (record.stake != NO_STAKE)
+        {
+            stakes[record.stake].rings = record.stake_rings;
+        }
+        key = record.key;
+        raw_scores = record.raw_scores;
+        GREAT_RISKS_CHECK(key == zobrist_key(*this));
+        GREAT_RISKS_CHECK(occupancy == robot_cells(*this));
+        GREAT_RISKS_CHECK(raw_scores == recalculate_raw_scores());
+    }
+
+    template <typename G>
+    void BasicField<G>::tick()
+    {
+        key ^= zobrist_time(time_remaining);
+        time_remaining--;
+        key ^= zobrist_time(time_remaining);
+        GREAT_RISKS_CHECK(key == zobrist_key(*this));
+    }
+
+    template <typename G>
+    void BasicField<G>::untick()
+    {
+        key ^= zobrist_time(time_remaining);
+        time_remaining++;
+        key ^= zobrist_time(time_remaining);
+        GREAT_RISKS_CHECK(key == zobrist_key(*this));
+    }
+
+    template <typename G>
+    std::array<int, 2> BasicField<G>::calculate_scores() const
+    {
+        GREAT_RISKS_CHECK(raw_scores == recalculate_raw_scores());
+        return {std::max(raw_scores[RED], 0), std::max(raw_scores[BLUE], 0)};
+    }
+
+    // every ring counts once for its color and the top ring twice more, times the corner multiplier
+    template <typename G>
+    std::array<int, 2> BasicField<G>::goal_points(std::size_t i) const
+    {
+        const MobileGoal &goal = goals[i];
+        if (goal.rings.empty())
+        {
+            return {0, 0};
         }
+        int multiplier = corner_multiplier(goal.x, goal.y);
+        int blue = __builtin_popcount(goal.rings.color_bits());
+        int red = goal.rings.size() - blue;
+        (goal.rings.back() == RED ? red : blue) += 2;
+        return {red * multiplier, blue * multiplier};
     }
 
-    std::array<int, 2> Field::calculate_scores() const
+    template <typename G>
+    std::array<int, 2> BasicField<G>::stake_points(std::size_t i) const
+    {
+        const WallStake &stake = stakes[i];
+        if (stake.rings.empty())
+        {
+            return {0, 0};
+        }
+        int blue = __builtin_popcount(stake.rings.color_bits());
+        int red = stake.rings.size() - blue;
+        (stake.rings.back() == RED ? red : blue) += 2;
+        return {red, blue};
+    }
+
+    template <typename G>
+    std::array<int, 2> BasicField<G>::recalculate_raw_scores() const
     {
         int red_score = 0;
         int blue_score = 0;
@@ -326,15 +432,21 @@ namespace great_risks
             if (!goal.rings.empty())
             {
                 int multiplier = 1;
-                if (goal.x == 0 && (goal.y == 0 || goal.y == 10))
+                for (const auto &corner : G::NEGATIVE_CORNERS)
                 {
-                    multiplier = -1;
+                    if (goal.x == corner[0] && goal.y == corner[1])
+                    {
+                        multiplier = -1;
+                    }
                 }
-                else if (goal.x == 10 && (goal.y == 0 || goal.y == 10))
+                for (const auto &corner : G::POSITIVE_CORNERS)
                 {
-                    multiplier = 2;
+                    if (goal.x == corner[0] && goal.y == corner[1])
+                    {
+                        multiplier = 2;
+                    }
                 }
-                for (const auto &c : goal.rings)
+                for (auto c : goal.rings)
                 {
                     if (c == RED)
                     {
@@ -359,7 +471,7 @@ namespace great_risks
         {
             if (!stake.rings.empty())
             {
-                for (const auto &c : stake.rings)
+                for (auto c : stake.rings)
                 {
                     if (c == RED)
                     {
@@ -380,69 +492,45 @@ namespace great_risks
                 }
             }
         }
-        if (red_score < 0)
-        {
-            red_score = 0;
-        }
-        if (blue_score < 0)
-        {
-            blue_score = 0;
-        }
         return {red_score, blue_score};
     }
 
-    std::pair<std::array<std::uint8_t, 2>, std::vector<Action>> Field::shortest_path(
+    template <typename G>
+    PathResult BasicField<G>::shortest_path(std::array<std::uint8_t, 2> begin, CellMask targets, bool is_red) const
+    {
+        return great_risks::shortest_path<WIDTH>(free_cells(is_red), begin[0], begin[1], targets);
+    }
+
+    template <typename G>
+    std::pair<std::array<std::uint8_t, 2>, std::vector<Action>> BasicField<G>::shortest_path(
         std::array<std::uint8_t, 2> begin,
         std::unordered_set<std::array<std::uint8_t, 2>> targets,
         bool is_red) const
     {
-        std::unordered_set<std::array<std::uint8_t, 2>> explored;
-        std::deque<std::pair<std::array<std::uint8_t, 2>, std::vector<Action>>> queue;
-        queue.push_back({begin, std::vector<Action>()});
-        explored.insert(begin);
-        while (!queue.empty())
+        CellMask target_cells = 0;
+        for (const auto &target : targets)
         {
-            auto v = queue.front();
-            queue.pop_front();
-            if (targets.find(v.first) != targets.end())
+            if (target[0] < WIDTH && target[1] < WIDTH)
             {
-                return v;
-            }
-            auto x = v.first[0];
-            auto y = v.first[1];
-            std::array<std::uint8_t, 2> north_pos = {static_cast<uint8_t>(x - 1), y};
-            std::array<std::uint8_t, 2> south_pos = {static_cast<uint8_t>(x + 1), y};
-            std::array<std::uint8_t, 2> east_pos = {x, static_cast<uint8_t>(y + 1)};
-            std::array<std::uint8_t, 2> west_pos = {x, static_cast<uint8_t>(y - 1)};
-            if (legal_move(x - 1, y, is_red, *this) && explored.find(north_pos) == explored.end())
-            {
-                auto moves = v.second;
-                moves.push_back(MOVE_NORTH);
-                queue.push_back({north_pos, moves});
-                explored.insert(north_pos);
-            }
-            if (legal_move(x + 1, y, is_red, *this) && explored.find(south_pos) == explored.end())
-            {
-                auto moves = v.second;
-                moves.push_back(MOVE_SOUTH);
-                queue.push_back({south_pos, moves});
-                explored.insert(south_pos);
-            }
-            if (legal_move(x, y + 1, is_red, *this) && explored.find(east_pos) == explored.end())
-            {
-                auto moves = v.second;
-                moves.push_back(MOVE_EAST);
-                queue.push_back({east_pos, moves});
-                explored.insert(east_pos);
-            }
-            if (legal_move(x, y - 1, is_red, *this) && explored.find(west_pos) == explored.end())
-            {
-                auto moves = v.second;
-                moves.push_back(MOVE_WEST);
-                queue.push_back({west_pos, moves});
-                explored.insert(west_pos);
+                target_cells |= cell_bit(target[0] * WIDTH + target[1]);
             }
         }
-        return {begin, std::vector<Action>()};
+        std::array<std::uint8_t, WIDTH * WIDTH> parent;
+        unsigned start = begin[0] * WIDTH + begin[1];
+        unsigned target = bfs<WIDTH>(free_cells(is_red), start, target_cells, parent);
+        if (target == NO_CELL)
+        {
+            return {begin, std::vector<Action>()};
+        }
+        std::vector<Action> moves;
+        for (unsigned cell = target; cell != start; cell = parent[cell])
+        {
+            moves.push_back(step_direction<WIDTH>(parent[cell], cell));
+        }
+        std::reverse(moves.begin(), moves.end());
+        return {{static_cast<std::uint8_t>(target / WIDTH), static_cast<std::uint8_t>(target % WIDTH)}, moves};
     }
+
+    template class BasicField<FieldGeometry>;
+    template class BasicField<ReducedGeometry>;
 }  // namespace great_risks
@@ -1,8 +1,16 @@
 #pragma once
 
+#include "actions.hh"
+#include "bitboard.hh"
+#include "fixed_vector.hh"
+#include "path.hh"
+#include "ring_stack.hh"
+#include "zobrist.hh"
+
 #include <array>
 #include <cstdint>
 #include <string>
+#include <type_traits>
 #include <unordered_set>
 #include <vector>
 
@@ -29,21 +37,21 @@ namespace std
 
 #define ON_ROBOT 255
 #define NO_GOAL 255
+#define NO_STAKE 255
 
 namespace great_risks
 {
-    enum Ring
-    {
-        RED,
-        BLUE
-    };
+    constexpr std::size_t MAX_GOAL_RINGS = 6;
+    constexpr std::size_t MAX_STAKE_RINGS = 6;
+    constexpr std::size_t MAX_ROBOT_RINGS = 2;
+    constexpr std::size_t MAX_ROBOTS = 4;
 
     struct MobileGoal
     {
         std::uint8_t x;
         std::uint8_t y;
-        std::vector<Ring> rings;
-        bool tipped;
+        RingStack<MAX_GOAL_RINGS> rings;
+        bool tipped = false;
 
         bool operator==(const MobileGoal &other) const
         {
@@ -55,7 +63,7 @@ namespace great_risks
     {
         std::uint8_t x;
         std::uint8_t y;
-        std::vector<Ring> rings;
+        RingStack<MAX_STAKE_RINGS> rings;
 
         bool operator==(const WallStake &other) const
         {
@@ -68,8 +76,8 @@ namespace great_risks
         std::uint8_t x;
         std::uint8_t y;
         std::uint8_t goal = NO_GOAL;
-        std::vector<Ring> rings;
-        bool is_red;
+        RingStack<MAX_ROBOT_RINGS> rings;
+        bool is_red = false;
 
         bool operator==(const Robot &other) const
         {
@@ -79,131 +87,265 @@ namespace great_risks
         }
     };
 
-    enum Action
+    // State overwritten by a single action, enough for undo_action() to restore the field exactly.
+    // Tree search keeps one of these per ply on its current path instead of a field per node.
+    struct UndoRecord
+    {
+        Action action;
+        Robot robot;
+        // goal and stake touched by the action, if any
+        std::uint8_t goal = NO_GOAL;
+        std::uint8_t stake = NO_STAKE;
+        MobileGoal goal_state;
+        RingStack<MAX_STAKE_RINGS> stake_rings;
+        std::uint64_t key;
+        std::array<int, 2> raw_scores;
+    };
+
+    enum Phase
+    {
+        MATCH,
+        AUTONOMOUS_RED,
+        AUTONOMOUS_BLUE
+    };
+
+    // rings lying on a cell at the start of a match
+    struct RingPile
     {
-        MOVE_NORTH,
-        MOVE_SOUTH,
-        MOVE_EAST,
-        MOVE_WEST,
-        GRAB_MOBILE_GOAL,
-        RELEASE_MOBILE_GOAL,
-        TIP_MOBILE_GOAL,
-        UNTIP_MOBILE_GOAL,
-        PICK_UP_RED,
-        PICK_UP_BLUE,
-        RELEASE_RING,
-        SCORE_MOBILE_GOAL,
-        SCORE_WALL_STAKE,
-        DESCORE_MOBILE_GOAL,
-        DESCORE_WALL_STAKE,
-        DO_NOTHING
+        std::uint8_t x;
+        std::uint8_t y;
+        std::uint8_t red;
+        std::uint8_t blue;
     };
 
-    class Field
+    // Layout and rules of the full 11x11 field. Everything a field variant differs in is a
+    // compile time trait, so BasicField loops over goals, stakes and cells with constant bounds.
+    struct FieldGeometry
+    {
+        static constexpr std::uint8_t WIDTH = 11;
+        static constexpr std::size_t MAX_ROBOTS = 4;
+        static constexpr std::uint8_t START_TIME = 120;
+        // autonomous period lasts while time_remaining is above this
+        static constexpr std::uint8_t AUTONOMOUS_END = 90;
+        // goals in positive corners cannot be touched once time_remaining is at or below this
+        static constexpr int PROTECTED_CORNER_TIME = 15;
+        static constexpr bool CAN_DO_NOTHING = true;
+        static constexpr std::array<std::array<std::uint8_t, 2>, 5> GOALS = {{{1, 5}, {5, 1}, {5, 5}, {5, 9}, {9, 5}}};
+        static constexpr std::array<std::array<std::uint8_t, 2>, 2> STAKES = {{{0, 5}, {10, 5}}};
+        static constexpr std::array<std::array<std::uint8_t, 2>, 4> POSTS = {{{3, 5}, {5, 3}, {5, 7}, {7, 5}}};
+        static constexpr std::array<std::array<std::uint8_t, 2>, 2> NEGATIVE_CORNERS = {{{0, 0}, {0, 10}}};
+        static constexpr std::array<std::array<std::uint8_t, 2>, 2> POSITIVE_CORNERS = {{{10, 0}, {10, 10}}};
+        static constexpr std::array<RingPile, 20> RINGS = {{
+            {0, 0, 2, 2},
+            {0, 5, 1, 1},
+            {0, 10, 2, 2},
+            {1, 1, 1, 1},
+            {1, 3, 1, 1},
+            {1, 7, 1, 1},
+            {1, 9, 1, 1},
+            {3, 3, 0, 1},
+            {3, 7, 1, 0},
+            {5, 0, 1, 1},
+            {5, 10, 1, 1},
+            {7, 3, 0, 1},
+            {7, 7, 1, 0},
+            {9, 1, 1, 1},
+            {9, 3, 1, 1},
+            {9, 7, 1, 1},
+            {9, 9, 1, 1},
+            {10, 0, 2, 2},
+            {10, 5, 1, 1},
+            {10, 10, 2, 2},
+        }};
+        // robots are placed by the caller through add_robot()
+        static constexpr std::array<Robot, 0> ROBOTS = {};
+    };
+
+    // Cells robots may drive on in each phase: the whole field except the posts, and during
+    // autonomous only the half of the alliance (the center line is shared).
+    template <typename G>
+    constexpr std::array<CellMask, 3> make_walkable()
+    {
+        std::array<CellMask, 3> walkable = {};
+        for (unsigned x = 0; x < G::WIDTH; x++)
+        {
+            for (unsigned y = 0; y < G::WIDTH; y++)
+            {
+                bool post = false;
+                for (const auto &cell : G::POSTS)
+                {
+                    post = post || (cell[0] == x && cell[1] == y);
+                }
+                if (post)
+                {
+                    continue;
+                }
+                walkable[MATCH] |= cell_bit(x * G::WIDTH + y);
+                if (y <= G::WIDTH / 2)
+                {
+                    walkable[AUTONOMOUS_RED] |= cell_bit(x * G::WIDTH + y);
+                }
+                if (y >= G::WIDTH / 2)
+                {
+                    walkable[AUTONOMOUS_BLUE] |= cell_bit(x * G::WIDTH + y);
+                }
+            }
+        }
+        return walkable;
+    }
+
+    // Game state for any field variant G (see FieldGeometry for the traits it has to provide).
+    // Member functions are defined in simulator.cc and instantiated there for every variant.
+    template <typename G>
+    class BasicField
     {
+        static_assert(G::WIDTH * G::WIDTH < ZobristKeys::ON_ROBOT_CELL);
+        static_assert(G::MAX_ROBOTS <= ZobristKeys::ROBOTS);
+        static_assert(G::GOALS.size() <= ZobristKeys::GOALS);
+        static_assert(G::STAKES.size() <= ZobristKeys::STAKES);
+
     public:
-        std::array<MobileGoal, 5> goals;
-        std::array<WallStake, 2> stakes;
-        std::array<std::array<uint8_t, 11>, 11> red_rings = {};
-        std::array<std::array<uint8_t, 11>, 11> blue_rings = {};
-        std::vector<Robot> robots;
-        std::uint8_t time_remaining = 120;
-        Field();
+        using Geometry = G;
+        static constexpr std::uint8_t WIDTH = G::WIDTH;
+        static constexpr std::uint8_t AUTONOMOUS_END = G::AUTONOMOUS_END;
+        static constexpr std::array<CellMask, 3> WALKABLE = make_walkable<G>();
+
+        std::array<MobileGoal, G::GOALS.size()> goals;
+        std::array<WallStake, G::STAKES.size()> stakes;
+        std::array<std::array<uint8_t, WIDTH>, WIDTH> red_rings = {};
+        std::array<std::array<uint8_t, WIDTH>, WIDTH> blue_rings = {};
+        FixedVector<Robot, G::MAX_ROBOTS> robots;
+        // only change through tick() so the key stays in sync
+        std::uint8_t time_remaining = G::START_TIME;
+        // Zobrist key of the whole state, updated incrementally by every mutating method
+        std::uint64_t key = 0;
+        // cells taken by robots, kept in sync with robot positions
+        CellMask occupancy = 0;
+        // red and blue score before clamping at zero, updated whenever a goal or stake changes
+        std::array<int, 2> raw_scores = {};
+        BasicField();
         void add_robot(Robot robot);
+        ActionMask legal_action_mask(std::uint8_t i) const;
+        ActionMask legal_moves(std::uint8_t i) const;
+        // same actions as legal_action_mask() as a list in ACTION_ORDER
         std::vector<Action> legal_actions(std::uint8_t i) const;
         void perform_action(std::uint8_t i, Action a);
+        UndoRecord perform_action_undoable(std::uint8_t i, Action a);
+        void undo_action(std::uint8_t i, const UndoRecord &record);
+        void tick();
+        void untick();
         std::array<int, 2> calculate_scores() const;
+        // full rescan of goals and stakes, used to initialize and check raw_scores
+        std::array<int, 2> recalculate_raw_scores() const;
+        std::array<int, 2> goal_points(std::size_t i) const;
+        std::array<int, 2> stake_points(std::size_t i) const;
+        PathResult shortest_path(std::array<std::uint8_t, 2> begin, CellMask targets, bool is_red) const;
         std::pair<std::array<std::uint8_t, 2>, std::vector<Action>> shortest_path(
             std::array<std::uint8_t, 2> begin,
             std::unordered_set<std::array<std::uint8_t, 2>> targets,
             bool is_red) const;
 
-        bool operator==(const Field &other) const
+        // scoring multiplier of a goal standing on (x, y), goals on robots count once
+        static int corner_multiplier(int x, int y)
+        {
+            for (const auto &corner : G::NEGATIVE_CORNERS)
+            {
+                if (corner[0] == x && corner[1] == y)
+                {
+                    return -1;
+                }
+            }
+            for (const auto &corner : G::POSITIVE_CORNERS)
+            {
+                if (corner[0] == x && corner[1] == y)
+                {
+                    return 2;
+                }
+            }
+            return 1;
+        }
+
+        static bool in_protected_corner(int x, int y, int time_remaining)
+        {
+            if (time_remaining > G::PROTECTED_CORNER_TIME)
+            {
+                return false;
+            }
+            for (const auto &corner : G::POSITIVE_CORNERS)
+            {
+                if (corner[0] == x && corner[1] == y)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // cells a robot of the given alliance could move into right now
+        CellMask free_cells(bool is_red) const
+        {
+            Phase phase = time_remaining <= AUTONOMOUS_END ? MATCH : is_red ? AUTONOMOUS_RED : AUTONOMOUS_BLUE;
+            return WALKABLE[phase] & ~occupancy;
+        }
+
+        bool operator==(const BasicField &other) const
         {
             return (
-                time_remaining == other.time_remaining &&
+                key == other.key && time_remaining == other.time_remaining &&
                 std::equal(goals.begin(), goals.end(), other.goals.begin()) &&
                 std::equal(stakes.begin(), stakes.end(), other.stakes.begin()) &&
-                std::equal(robots.begin(), robots.end(), other.robots.begin()) &&
+                robots == other.robots &&
                 std::equal(red_rings.begin(), red_rings.end(), other.red_rings.begin()) &&
                 std::equal(blue_rings.begin(), blue_rings.end(), other.blue_rings.begin()));
         }
-    };
 
-    bool in_protected_corner(int x, int y, int time_remaining);
-}  // namespace great_risks
-
-namespace std
-{
-    template <>
-    struct hash<great_risks::MobileGoal>
-    {
-        size_t operator()(const great_risks::MobileGoal &goal) const noexcept
+    private:
+        // take a goal or stake out of the key and scores before changing it, put it back after
+        void detach_goal(std::size_t i)
         {
-            size_t hash = goal.x;
-            hash = (hash << 4) + goal.y;
-            for (auto &ring : goal.rings)
-            {
-                hash = (hash << 4) + ring;
-            }
-            return hash;
+            key ^= zobrist_goal(*this, i);
+            auto points = goal_points(i);
+            raw_scores[RED] -= points[RED];
+            raw_scores[BLUE] -= points[BLUE];
         }
-    };
 
-    template <>
-    struct hash<great_risks::WallStake>
-    {
-        size_t operator()(const great_risks::WallStake &stake) const noexcept
+        void attach_goal(std::size_t i)
         {
-            size_t hash = stake.x;
-            hash = (hash << 4) + stake.y;
-            for (auto &ring : stake.rings)
-            {
-                hash = (hash << 4) + ring;
-            }
-            return hash;
+            key ^= zobrist_goal(*this, i);
+            auto points = goal_points(i);
+            raw_scores[RED] += points[RED];
+            raw_scores[BLUE] += points[BLUE];
         }
-    };
 
-    template <>
-    struct hash<great_risks::Robot>
-    {
-        size_t operator()(const great_risks::Robot &robot) const noexcept
+        void detach_stake(std::size_t i)
         {
-            size_t hash = robot.x;
-            hash = (hash << 4) + robot.y;
-            hash = (hash << 4) + robot.goal;
-            for (auto &ring : robot.rings)
-            {
-                hash = (hash << 4) + ring;
-            }
-            return hash;
+            key ^= zobrist_stake(*this, i);
+            auto points = stake_points(i);
+            raw_scores[RED] -= points[RED];
+            raw_scores[BLUE] -= points[BLUE];
         }
-    };
 
-    template <>
-    struct hash<great_risks::Field>
-    {
-        size_t operator()(const great_risks::Field &field) const noexcept
+        void attach_stake(std::size_t i)
         {
-            size_t seed = 0;
-            hash<great_risks::MobileGoal> goal_hash;
-            for (auto &goal : field.goals)
-            {
-                seed ^= goal_hash(goal) + (seed << 6) + (seed >> 2);
-            }
-            hash<great_risks::WallStake> stake_hash;
-            for (auto &stake : field.stakes)
-            {
-                seed ^= stake_hash(stake) + (seed << 6) + (seed >> 2);
-            }
-            hash<great_risks::Robot> robot_hash;
-            for (auto &robot : field.robots)
-            {
-                seed ^= robot_hash(robot) + (seed << 6) + (seed >> 2);
-            }
-            seed = field.time_remaining + (seed << 6) + (seed >> 2);
-            return seed;
+            key ^= zobrist_stake(*this, i);
+            auto points = stake_points(i);
+            raw_scores[RED] += points[RED];
+            raw_scores[BLUE] += points[BLUE];
         }
     };
-}  // namespace std
+
+    using Field = BasicField<FieldGeometry>;
+    extern template class BasicField<FieldGeometry>;
+
+    // every playout and search worker starts from a copy, so a Field has to stay a flat block of memory
+    static_assert(std::is_trivially_copyable_v<Field>);
+}  // namespace great_risks
+
+template <typename G>
+struct std::hash<great_risks::BasicField<G>>
+{
+    size_t operator()(const great_risks::BasicField<G> &field) const noexcept
+    {
+        return field.key;
+    }
+};
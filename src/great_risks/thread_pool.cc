@@ -0,0 +1,200 @@
+#include "thread_pool.hh"
+
+#include <algorithm>
+#include <iterator>
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+namespace great_risks
+{
+    // pool and queue of the worker running on this thread, if any
+    thread_local ThreadPool *current_pool = nullptr;
+    thread_local std::size_t current_worker = 0;
+
+    unsigned global_num_threads = std::thread::hardware_concurrency();
+    bool global_pin = false;
+
+    void pin_to_core(std::size_t i)
+    {
+#ifdef __linux__
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(i % std::max(std::thread::hardware_concurrency(), 1u), &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+    }
+
+    ThreadPool::ThreadPool(unsigned num_threads, bool pin)
+    {
+        num_threads = std::max(num_threads, 1u);
+        for (unsigned i = 0; i < num_threads; i++)
+        {
+            queues.push_back(std::make_unique<Queue>());
+        }
+        for (unsigned i = 0; i < num_threads; i++)
+        {
+            workers.emplace_back(&ThreadPool::work, this, i, pin);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    bool ThreadPool::pop(std::size_t i, Task &task)
+    {
+        Queue &queue = *queues[i];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+        {
+            return false;
+        }
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        queue.size--;
+        queued--;
+        task.group->queued--;
+        return true;
+    }
+
+    bool ThreadPool::steal(std::size_t i, Task &task)
+    {
+        for (std::size_t k = 1; k < queues.size(); k++)
+        {
+            Queue &queue = *queues[(i + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                queue.size--;
+                queued--;
+                task.group->queued--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // newest task of the group, looking in the caller's own deque first
+    bool ThreadPool::take(TaskGroup &group, Task &task)
+    {
+        std::size_t first = current_pool == this ? current_worker : 0;
+        for (std::size_t k = 0; k < queues.size() && group.queued > 0; k++)
+        {
+            Queue &queue = *queues[(first + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            for (auto it = queue.tasks.rbegin(); it != queue.tasks.rend(); ++it)
+            {
+                if (it->group == &group)
+                {
+                    task = std::move(*it);
+                    queue.tasks.erase(std::next(it).base());
+                    queue.size--;
+                    queued--;
+                    group.queued--;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void ThreadPool::run(Task &task)
+    {
+        task.run();
+        if (task.group->pending.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            progress.notify_all();
+        }
+    }
+
+    void ThreadPool::work(std::size_t i, bool pin)
+    {
+        current_pool = this;
+        current_worker = i;
+        if (pin)
+        {
+            pin_to_core(i);
+        }
+        while (true)
+        {
+            Task task;
+            if (pop(i, task) || steal(i, task))
+            {
+                run(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            wake.wait(lock, [&] { return stopping || queued > 0; });
+            if (stopping && queued == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    void ThreadPool::submit(TaskGroup &group, std::function<void()> task)
+    {
+        std::size_t i = current_pool == this ? current_worker : next_queue++ % queues.size();
+        group.pending++;
+        {
+            Queue &queue = *queues[i];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back({std::move(task), &group});
+            queue.size++;
+            group.queued++;
+        }
+        queued++;
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        // any idle worker can take it, but only the waiter of its group can tell it's meant for it
+        wake.notify_one();
+        if (waiting > 0)
+        {
+            progress.notify_all();
+        }
+    }
+
+    void ThreadPool::wait(TaskGroup &group)
+    {
+        // Only tasks of the group are run here: any other task, even one from the own deque, could
+        // be a long one of someone else (a whole match) and hold up the caller long after its own
+        // group has finished.
+        while (group.pending > 0)
+        {
+            Task task;
+            if (take(group, task))
+            {
+                run(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            waiting++;
+            progress.wait(lock, [&] { return group.pending == 0 || group.queued > 0; });
+            waiting--;
+        }
+    }
+
+    ThreadPool &ThreadPool::global()
+    {
+        static ThreadPool pool(global_num_threads, global_pin);
+        return pool;
+    }
+
+    void ThreadPool::configure(unsigned num_threads, bool pin)
+    {
+        global_num_threads = num_threads;
+        global_pin = pin;
+    }
+}  // namespace great_risks
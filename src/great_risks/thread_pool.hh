@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace great_risks
+{
+    // Fixed set of worker threads with one task deque each. A worker runs its own tasks newest
+    // first and steals the oldest task of another worker when it runs dry. Tasks submitted from a
+    // worker go to its own deque, so a match running on a worker keeps its search tasks close.
+    class ThreadPool
+    {
+    public:
+        // tasks submitted together, wait() returns once all of them have finished
+        class TaskGroup
+        {
+        private:
+            std::atomic<int> pending = 0;
+            // tasks still sitting in a deque
+            std::atomic<int> queued = 0;
+            friend class ThreadPool;
+        };
+
+    private:
+        struct Task
+        {
+            std::function<void()> run;
+            TaskGroup *group;
+        };
+
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+            // tasks.size(), readable without the lock
+            std::atomic<int> size = 0;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<int> queued = 0;
+        std::atomic<unsigned> next_queue = 0;
+        std::mutex sleep_mutex;
+        // idle workers, one is woken per submitted task
+        std::condition_variable wake;
+        // callers blocked in wait(), woken when a group finishes or gets a task queued
+        std::condition_variable progress;
+        // callers blocked in wait(), guarded by sleep_mutex
+        int waiting = 0;
+        bool stopping = false;
+
+        bool pop(std::size_t i, Task &task);
+        bool steal(std::size_t i, Task &task);
+        bool take(TaskGroup &group, Task &task);
+        void run(Task &task);
+        void work(std::size_t i, bool pin);
+
+    public:
+        explicit ThreadPool(unsigned num_threads = std::thread::hardware_concurrency(), bool pin = false);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        unsigned size() const
+        {
+            return workers.size();
+        }
+
+        void submit(TaskGroup &group, std::function<void()> task);
+        // blocks until every task of the group has run; the caller runs queued tasks of the group
+        // meanwhile, so tasks may wait on groups of their own without deadlocking the pool
+        void wait(TaskGroup &group);
+
+        // Pool shared by the whole process, created on first use. configure() only has an effect
+        // before that.
+        static ThreadPool &global();
+        static void configure(unsigned num_threads, bool pin);
+    };
+}  // namespace great_risks
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "ring_stack.hh"
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+namespace great_risks
+{
+    // Random keys for Zobrist hashing of field states. A state's key is the XOR of one key per
+    // component, so actions can update it by XOR-ing out the old value of the components they
+    // touch and XOR-ing in the new one. Cells are indexed as x * width + y, goals on a robot
+    // use the last cell.
+    struct ZobristKeys
+    {
+        static constexpr std::size_t CELLS = 128;
+        static constexpr std::size_t ON_ROBOT_CELL = CELLS - 1;
+        static constexpr std::size_t ROBOTS = 4;
+        static constexpr std::size_t GOALS = 8;
+        static constexpr std::size_t STAKES = 2;
+
+        std::array<std::array<std::uint64_t, CELLS>, ROBOTS> robot_cell = {};
+        std::array<std::array<std::uint64_t, 8>, ROBOTS> robot_goal = {};
+        std::array<std::array<std::uint64_t, 8>, ROBOTS> robot_rings = {};
+        std::array<std::array<std::uint64_t, CELLS>, GOALS> goal_cell = {};
+        std::array<std::uint64_t, GOALS> goal_tipped = {};
+        std::array<std::array<std::uint64_t, 128>, GOALS> goal_rings = {};
+        std::array<std::array<std::uint64_t, 128>, STAKES> stake_rings = {};
+        // loose rings are hashed as key * count so a cell needs one key per color
+        std::array<std::array<std::uint64_t, CELLS>, 2> loose_rings = {};
+        std::array<std::uint64_t, 256> time = {};
+    };
+
+    constexpr std::uint64_t splitmix64(std::uint64_t &state)
+    {
+        std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    template <typename T, std::size_t N>
+    constexpr void fill_keys(std::array<T, N> &keys, std::uint64_t &state)
+    {
+        for (auto &key : keys)
+        {
+            if constexpr (std::is_same_v<T, std::uint64_t>)
+            {
+                key = splitmix64(state);
+            }
+            else
+            {
+                fill_keys(key, state);
+            }
+        }
+    }
+
+    constexpr ZobristKeys make_zobrist_keys()
+    {
+        ZobristKeys keys;
+        std::uint64_t state = 0x6772656174726b73ull;
+        fill_keys(keys.robot_cell, state);
+        fill_keys(keys.robot_goal, state);
+        fill_keys(keys.robot_rings, state);
+        fill_keys(keys.goal_cell, state);
+        fill_keys(keys.goal_tipped, state);
+        fill_keys(keys.goal_rings, state);
+        fill_keys(keys.stake_rings, state);
+        fill_keys(keys.loose_rings, state);
+        fill_keys(keys.time, state);
+        return keys;
+    }
+
+    inline constexpr ZobristKeys ZOBRIST = make_zobrist_keys();
+
+    // The helpers below work for any field type exposing WIDTH, goals, stakes, robots and the
+    // loose ring grids.
+
+    template <typename F>
+    std::uint64_t zobrist_robot(const F &field, std::size_t i)
+    {
+        const auto &robot = field.robots[i];
+        return ZOBRIST.robot_cell[i][robot.x * F::WIDTH + robot.y] ^ ZOBRIST.robot_goal[i][robot.goal & 7] ^
+               ZOBRIST.robot_rings[i][robot.rings.code()];
+    }
+
+    template <typename F>
+    std::uint64_t zobrist_goal(const F &field, std::size_t i)
+    {
+        const auto &goal = field.goals[i];
+        std::size_t cell = goal.x >= F::WIDTH ? ZobristKeys::ON_ROBOT_CELL : goal.x * F::WIDTH + goal.y;
+        std::uint64_t key = ZOBRIST.goal_cell[i][cell] ^ ZOBRIST.goal_rings[i][goal.rings.code()];
+        if (goal.tipped)
+        {
+            key ^= ZOBRIST.goal_tipped[i];
+        }
+        return key;
+    }
+
+    template <typename F>
+    std::uint64_t zobrist_stake(const F &field, std::size_t i)
+    {
+        return ZOBRIST.stake_rings[i][field.stakes[i].rings.code()];
+    }
+
+    template <typename F>
+    std::uint64_t zobrist_loose_rings(const F &field, std::uint8_t x, std::uint8_t y)
+    {
+        std::size_t cell = x * F::WIDTH + y;
+        return ZOBRIST.loose_rings[RED][cell] * field.red_rings[x][y] ^
+               ZOBRIST.loose_rings[BLUE][cell] * field.blue_rings[x][y];
+    }
+
+    inline std::uint64_t zobrist_time(std::uint8_t time_remaining)
+    {
+        return ZOBRIST.time[time_remaining];
+    }
+
+    // full recomputation, used to initialize keys and to check incremental updates
+    template <typename F>
+    std::uint64_t zobrist_key(const F &field)
+    {
+        static_assert(F::WIDTH * F::WIDTH < ZobristKeys::ON_ROBOT_CELL);
+        std::uint64_t key = zobrist_time(field.time_remaining);
+        for (std::size_t i = 0; i < field.robots.size(); i++)
+        {
+            key ^= zobrist_robot(field, i);
+        }
+        for (std::size_t i = 0; i < field.goals.size(); i++)
+        {
+            key ^= zobrist_goal(field, i);
+        }
+        for (std::size_t i = 0; i < field.stakes.size(); i++)
+        {
+            key ^= zobrist_stake(field, i);
+        }
+        for (std::uint8_t x = 0; x < F::WIDTH; x++)
+        {
+            for (std::uint8_t y = 0; y < F::WIDTH; y++)
+            {
+                key ^= zobrist_loose_rings(field, x, y);
+            }
+        }
+        return key;
+    }
+}  // namespace great_risks